@@ -0,0 +1,458 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2016, Michele Bosi, John Lagerquist                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "vlGLFW/DropLoader.hpp"
+#include "vlCore/Log.hpp"
+#include "vlCore/Say.hpp"
+#include <GLFW/GLFW3.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace vlGLFW;
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+// DropLoader::State
+//-----------------------------------------------------------------------------
+// Shared by a DropLoader and the workers processing its files. Nothing in here is reference
+// counted: workers only see the raw DroppedFile, the DropLoader keeps the ref on the main thread.
+struct vlGLFW::DropLoader::State
+{
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::atomic<bool> cancelled { false };
+    DropLoader::Parser parser;
+};
+
+// What a worker knows about a file: no ref, the guarded flags tell the main thread when it may release it.
+struct vlGLFW::DropLoader::Job
+{
+    DroppedFile* file = nullptr;
+    bool started = false;
+    bool done = false;
+};
+
+namespace
+{
+// bytes read between two progress updates and cancellation checks
+const size_t read_chunk = 16 << 20;
+}
+
+//-----------------------------------------------------------------------------
+// DropLoader::Pool
+//-----------------------------------------------------------------------------
+// Worker threads shared by all the DropLoaders.
+struct vlGLFW::DropLoader::Pool
+{
+public:
+    typedef std::pair< std::shared_ptr<DropLoader::State>, std::shared_ptr<DropLoader::Job> > Task;
+
+    Pool()
+    {
+        // leave room for the render thread and the driver
+        unsigned n = std::max(1u, std::thread::hardware_concurrency() / 2);
+        for ( unsigned i = 0; i < n; ++i )
+            mThreads.emplace_back(&Pool::run, this);
+    }
+
+    ~Pool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+
+        for ( auto& t : mThreads )
+            t.join();
+    }
+
+    static Pool& instance()
+    {
+        static Pool pool;
+        return pool;
+    }
+
+    void push( const Task& task )
+    {
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            mTasks.push_back(task);
+        }
+        mCondition.notify_one();
+    }
+
+    unsigned size() const { return unsigned(mThreads.size()); }
+
+protected:
+    void run()
+    {
+        for ( ;; )
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this] { return mStop || !mTasks.empty(); });
+                if ( mStop )
+                    return;
+                task = mTasks.front();
+                mTasks.pop_front();
+            }
+
+            State& state = *task.first;
+            Job& job = *task.second;
+            DropLoader::Parser parser;
+            {
+                // a cancelled job is never touched, so its DroppedFile may already be gone
+                std::lock_guard<std::mutex> guard(state.mutex);
+                job.started = !state.cancelled;
+                job.done = !job.started;
+                parser = state.parser;
+            }
+
+            if ( job.started )
+            {
+                process(state, parser, *job.file);
+
+                std::lock_guard<std::mutex> guard(state.mutex);
+                job.done = true;
+
+                // wake up an event loop blocked in glfwWaitEvents(), GLFW is alive as long as the loader is
+                if ( !state.cancelled )
+                    glfwPostEmptyEvent();
+            }
+            state.finished.notify_all();
+        }
+    }
+
+    static void process( const DropLoader::State& state, const DropLoader::Parser& parser, DroppedFile& file )
+    {
+        if ( state.cancelled || !file.mapFile() )
+            return;
+
+        bool parse = static_cast<bool>(parser);
+        file.setProgressRange(0, parse ? 0.5f : 1.0f);
+
+        // fault the pages in here rather than on the main thread
+        volatile unsigned char sink = 0;
+        for ( size_t offset = 0; offset < file.size(); offset += read_chunk )
+        {
+            size_t end = std::min(file.size(), offset + read_chunk);
+            for ( size_t i = offset; i < end; i += 4096 )
+                sink ^= file.data()[i];
+
+            file.setProgress(float(end) / file.size());
+            if ( state.cancelled )
+                return;
+        }
+        (void)sink;
+
+        if ( parse )
+        {
+            file.setProgressRange(0.5f, 0.5f);
+            if ( !parser(file) && file.error().empty() )
+                file.failed("parser failed");
+        }
+
+        file.setProgressRange(0, 1);
+        file.setProgress(1);
+    }
+
+protected:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Task> mTasks;
+    std::vector<std::thread> mThreads;
+    bool mStop = false;
+};
+
+//-----------------------------------------------------------------------------
+// DroppedFile
+//-----------------------------------------------------------------------------
+vlGLFW::DroppedFile::DroppedFile( const vl::String& path ): mPath(path)
+{
+}
+//-----------------------------------------------------------------------------
+vlGLFW::DroppedFile::~DroppedFile()
+{
+    unmap();
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::DroppedFile::setProgress( float progress )
+{
+    mProgress.store(mProgressBase + mProgressScale * std::min(1.0f, std::max(0.0f, progress)), std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+bool vlGLFW::DroppedFile::cancelled() const
+{
+    return mCancelled && mCancelled->load(std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+bool vlGLFW::DroppedFile::mapFile()
+{
+#ifdef WIN32
+    HANDLE file = CreateFileW(mPath.toStdWString().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+        failed("cannot open file");
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    mSize = size_t(size.QuadPart);
+
+    if ( mSize )
+    {
+        HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if ( mapping )
+        {
+            mData = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(mPath.toStdString().c_str(), O_RDONLY);
+    if ( fd < 0 )
+    {
+        failed("cannot open file");
+        return false;
+    }
+
+    struct stat st;
+    if ( fstat(fd, &st) == 0 )
+        mSize = size_t(st.st_size);
+
+    if ( mSize )
+    {
+        void* p = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if ( p != MAP_FAILED )
+        {
+            madvise(p, mSize, MADV_SEQUENTIAL);
+            mData = static_cast<const unsigned char*>(p);
+        }
+    }
+    close(fd);
+#endif
+
+    if ( mSize && !mData )
+    {
+        failed("cannot map file");
+        return false;
+    }
+    return true;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::DroppedFile::unmap()
+{
+    if ( mData )
+    {
+#ifdef WIN32
+        UnmapViewOfFile(mData);
+#else
+        munmap(const_cast<unsigned char*>(mData), mSize);
+#endif
+    }
+    mData = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// DropLoader
+//-----------------------------------------------------------------------------
+vlGLFW::DropLoader::DropLoader(): mState(std::make_shared<State>())
+{
+}
+//-----------------------------------------------------------------------------
+vlGLFW::DropLoader::~DropLoader()
+{
+    {
+        std::lock_guard<std::mutex> guard(mState->mutex);
+        mState->cancelled = true;
+    }
+
+    // the refs are released below on this thread, once no worker uses the files anymore
+    waitIdle(mEntries);
+    waitIdle(mCancelled);
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::DropLoader::setParser( const Parser& parser )
+{
+    std::lock_guard<std::mutex> guard(mState->mutex);
+    mState->parser = parser;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::DropLoader::load( const std::vector<vl::String>& paths )
+{
+    std::vector< std::shared_ptr<Job> > jobs;
+    unsigned batch = mBatches++;
+
+    for ( const String& path : paths )
+    {
+        Entry entry;
+        entry.state = mState;
+        entry.job = std::make_shared<Job>();
+        entry.file = new DroppedFile(path);
+        entry.file->mCancelled = &mState->cancelled;
+        entry.job->file = entry.file.get();
+        entry.batch = batch;
+        mEntries.push_back(entry);
+        jobs.push_back(entry.job);
+    }
+
+    for ( auto& job : jobs )
+        Pool::instance().push(Pool::Task(mState, job));
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::DropLoader::deliver()
+{
+    releaseCancelled();
+
+    std::vector< ref<DroppedFile> > ready;
+    {
+        std::lock_guard<std::mutex> guard(mState->mutex);
+
+        // files are handed over in drop order, a batch only once all of its files are done
+        while ( !mEntries.empty() && mEntries.front().job->done )
+        {
+            unsigned batch = mEntries.front().batch;
+            size_t end = 1;
+            if ( !mReadyCallback )
+            {
+                while ( end < mEntries.size() && mEntries[end].batch == batch )
+                    ++end;
+                if ( !std::all_of(mEntries.begin(), mEntries.begin() + end, []( const Entry& e ) { return e.job->done; }) )
+                    break;
+            }
+
+            for ( size_t i = 0; i < end; ++i )
+            {
+                mEntries[i].file->mCancelled = nullptr;
+                ready.push_back(mEntries[i].file);
+            }
+            mEntries.erase(mEntries.begin(), mEntries.begin() + end);
+        }
+    }
+
+    if ( mReadyCallback )
+    {
+        for ( auto& file : ready )
+            mReadyCallback(file.get());
+        return;
+    }
+
+    std::vector< ref<DroppedFile> > batch;
+    for ( auto& file : ready )
+    {
+        if ( file->ok() )
+            batch.push_back(file);
+        else
+            Log::warning( Say("vlGLFW: could not load dropped file \"%s\": %s.\n") << file->path() << file->error() );
+    }
+
+    if ( !batch.empty() && mBatchCallback )
+        mBatchCallback(batch);
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::DropLoader::cancel()
+{
+    Parser parser;
+    {
+        std::lock_guard<std::mutex> guard(mState->mutex);
+        mState->cancelled = true;
+        parser = mState->parser;
+    }
+
+    // in-flight files are kept here until their worker is done with them
+    mCancelled.insert(mCancelled.end(), mEntries.begin(), mEntries.end());
+    mEntries.clear();
+    releaseCancelled();
+
+    mState = std::make_shared<State>();
+    mState->parser = parser;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::DropLoader::releaseCancelled()
+{
+    auto idle = []( const Entry& e )
+    {
+        std::lock_guard<std::mutex> guard(e.state->mutex);
+        return !e.job->started || e.job->done;
+    };
+
+    mCancelled.erase(std::remove_if(mCancelled.begin(), mCancelled.end(), idle), mCancelled.end());
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::DropLoader::waitIdle( const std::deque<Entry>& entries )
+{
+    for ( const Entry& e : entries )
+    {
+        std::unique_lock<std::mutex> lock(e.state->mutex);
+        e.state->finished.wait(lock, [&e] { return !e.job->started || e.job->done; });
+    }
+}
+//-----------------------------------------------------------------------------
+size_t vlGLFW::DropLoader::pending() const
+{
+    std::lock_guard<std::mutex> guard(mState->mutex);
+    return size_t(std::count_if(mEntries.begin(), mEntries.end(), []( const Entry& e ) { return !e.job->done; }));
+}
+//-----------------------------------------------------------------------------
+std::vector< std::pair<vl::String, float> > vlGLFW::DropLoader::progress() const
+{
+    std::vector< std::pair<String, float> > result;
+    std::lock_guard<std::mutex> guard(mState->mutex);
+
+    for ( const Entry& e : mEntries )
+    {
+        if ( !e.job->done )
+            result.push_back(std::make_pair(e.file->path(), e.file->progress()));
+    }
+    return result;
+}
+//-----------------------------------------------------------------------------
+unsigned vlGLFW::DropLoader::workerCount()
+{
+    return Pool::instance().size();
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,190 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2016, Michele Bosi, John Lagerquist                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef DropLoader_INCLUDE_ONCE
+#define DropLoader_INCLUDE_ONCE
+
+#include <vlGLFW/link_config.hpp>
+#include <vlCore/Object.hpp>
+#include <vlCore/String.hpp>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace vlGLFW
+{
+//-----------------------------------------------------------------------------
+// DroppedFile
+//-----------------------------------------------------------------------------
+/**
+ * A file dropped on a GLFW_window and loaded in the background by a DropLoader. The file is memory-mapped
+ * read-only and its pages are touched by the worker so that the main thread never waits on the disk.
+*/
+class VLGLFW_EXPORT DroppedFile : public vl::Object
+{
+	friend class DropLoader;
+
+public:
+	DroppedFile(const vl::String& path);
+	~DroppedFile();
+
+	const vl::String& path() const { return mPath; }
+
+	//! The mapped file content, null if the file could not be mapped or was unmapped
+	const unsigned char* data() const { return mData; }
+
+	size_t size() const { return mSize; }
+
+	bool ok() const { return mError.empty() && !cancelled(); }
+
+	//! Why the file could not be loaded, empty on success
+	const vl::String& error() const { return mError; }
+
+	//! Loading progress from 0 to 1
+	float progress() const { return mProgress.load(std::memory_order_relaxed); }
+
+	//! Parsers call this to report how far they got, from 0 to 1
+	void setProgress(float progress);
+
+	//! Parsers should check this regularly and give up when it returns true
+	bool cancelled() const;
+
+	//! What the parser built from the file, e.g. vertex arrays ready to be uploaded
+	void setPayload(vl::Object* payload) { mPayload = payload; }
+
+	vl::Object* payload() const { return mPayload.get(); }
+
+	//! Releases the mapping, call it once the payload no longer needs the raw bytes
+	void unmap();
+
+protected:
+	bool mapFile();
+	void failed(const char* error) { mError = error; }
+	void setProgressRange(float base, float scale) { mProgressBase = base; mProgressScale = scale; }
+
+protected:
+	vl::String mPath;
+	vl::String mError;
+	const unsigned char* mData = nullptr;
+	size_t mSize = 0;
+	void* mMapping = nullptr;
+	std::atomic<float> mProgress { 0 };
+	float mProgressBase = 0;
+	float mProgressScale = 1;
+	const std::atomic<bool>* mCancelled = nullptr;
+	vl::ref<vl::Object> mPayload;
+};
+
+//-----------------------------------------------------------------------------
+// DropLoader
+//-----------------------------------------------------------------------------
+/**
+ * Loads the files dropped on a window with a process-wide pool of worker threads.
+ *
+ * Workers map each file, read it through and run the optional parser on it. Finished files are handed back on the
+ * main thread by deliver(), which GLFW_window calls on every event loop pass: to the ready callback if set,
+ * otherwise to the batch callback once the whole batch is ready, which GLFW_window turns into a file dropped event
+ * with the loaded files available from GLFW_window::droppedFiles(). cancel() (called when the window closes)
+ * discards pending work. Reference counts of the files are only touched by the main thread: workers see raw
+ * pointers, and cancelled files are released by deliver() or cancel() once their worker is done with them.
+ * Destroying the loader waits for the files being processed, which stop at their next cancellation check.
+*/
+class VLGLFW_EXPORT DropLoader
+{
+public:
+	//! Runs on a worker thread, returns false and sets no payload on failure
+	typedef std::function<bool(DroppedFile& file)> Parser;
+
+	//! Runs on the main thread between two frames
+	typedef std::function<void(DroppedFile* file)> ReadyCallback;
+
+	//! Runs on the main thread when a whole batch of dropped files is ready and no ReadyCallback is set, with the
+	//! files loaded successfully; the failed ones are logged
+	typedef std::function<void(const std::vector< vl::ref<DroppedFile> >& files)> BatchCallback;
+
+	DropLoader();
+	~DropLoader();
+
+	void setParser(const Parser& parser);
+
+	void setReadyCallback(const ReadyCallback& callback) { mReadyCallback = callback; }
+
+	void setBatchCallback(const BatchCallback& callback) { mBatchCallback = callback; }
+
+	//! Queues the files for loading, must be called from the main thread
+	void load(const std::vector<vl::String>& paths);
+
+	//! Hands over the files finished since the last call, must be called from the main thread
+	void deliver();
+
+	//! Drops all queued and in-flight files, the workers stop at their next check
+	void cancel();
+
+	//! Number of files queued or being loaded
+	size_t pending() const;
+
+	//! Path and progress of every file queued or being loaded
+	std::vector< std::pair<vl::String, float> > progress() const;
+
+	//! Number of worker threads shared by all loaders
+	static unsigned workerCount();
+
+private:
+	struct State;
+	struct Job;
+	struct Pool;
+
+protected:
+	// a file with the record its worker reports to, only touched by the main thread
+	struct Entry
+	{
+		std::shared_ptr<State> state;
+		std::shared_ptr<Job> job;
+		vl::ref<DroppedFile> file;
+		unsigned batch;
+	};
+
+	void releaseCancelled();
+	static void waitIdle(const std::deque<Entry>& entries);
+
+protected:
+	std::shared_ptr<State> mState;
+	std::deque<Entry> mEntries;
+	std::deque<Entry> mCancelled;
+	unsigned mBatches = 0;
+	ReadyCallback mReadyCallback;
+	BatchCallback mBatchCallback;
+};
+}
+
+#endif
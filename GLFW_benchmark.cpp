@@ -0,0 +1,398 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2016, Michele Bosi, John Lagerquist                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+// Multi-window throughput benchmark for the GLFW binding.
+//
+// Opens N windows, each rendering a grid of rotating cubes, runs a fixed number of frames per
+// window and reports startup time, per-window frame time percentiles, event loop overhead,
+// context switches and peak resident memory as CSV or JSON. With --partial-redraw one cube turns per frame
+// and only its part of the window is redrawn, which needs a VLGLFW_USE_EGL build for the back buffer age.
+// Runs without a GPU, e.g.:
+//
+//   xvfb-run -a env LIBGL_ALWAYS_SOFTWARE=1 ./GLFW_benchmark --windows 4 --frames 500 --headless --format json
+
+#include <vlCore/VisualizationLibrary.hpp>
+#include <vlCore/Time.hpp>
+#include <vlGraphics/Applet.hpp>
+#include <vlGraphics/GeometryPrimitives.hpp>
+#include <vlGraphics/Rendering.hpp>
+#include <vlGraphics/SceneManagerActorTree.hpp>
+#include <vlGraphics/Light.hpp>
+#include <vlGraphics/OpenGL.hpp>
+#include <vlGLFW/GLFW_window.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace vl;
+
+namespace
+{
+  struct options_t
+  {
+    int windows = 3;
+    int width = 512;
+    int height = 512;
+    int complexity = 1;  /* cubes per side of the grid rendered by each window */
+    int frames = 300;    /* frames rendered by each window */
+    bool vsync = false;
+    bool headless = false;
+    bool partial_redraw = false;
+    bool json = false;
+    const char* output = NULL;
+  };
+
+  void usage()
+  {
+    printf("usage: GLFW_benchmark [--windows N] [--width W] [--height H] [--complexity K] [--frames F]\n"
+           "                      [--vsync] [--headless] [--partial-redraw] [--format csv|json] [--output FILE]\n");
+  }
+
+  bool parse(int argc, char* args[], options_t& opt)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      const char* a = args[i];
+      const char* v = i + 1 < argc ? args[i + 1] : NULL;
+
+      if (strcmp(a, "--vsync") == 0)
+        opt.vsync = true;
+      else if (strcmp(a, "--headless") == 0)
+        opt.headless = true;
+      else if (strcmp(a, "--partial-redraw") == 0)
+        opt.partial_redraw = true;
+      else if (!v)
+        return false;
+      else if (strcmp(a, "--windows") == 0)
+        opt.windows = atoi(v), ++i;
+      else if (strcmp(a, "--width") == 0)
+        opt.width = atoi(v), ++i;
+      else if (strcmp(a, "--height") == 0)
+        opt.height = atoi(v), ++i;
+      else if (strcmp(a, "--complexity") == 0)
+        opt.complexity = atoi(v), ++i;
+      else if (strcmp(a, "--frames") == 0)
+        opt.frames = atoi(v), ++i;
+      else if (strcmp(a, "--format") == 0)
+        opt.json = strcmp(v, "json") == 0, ++i;
+      else if (strcmp(a, "--output") == 0)
+        opt.output = v, ++i;
+      else
+        return false;
+    }
+
+    return opt.windows > 0 && opt.width > 0 && opt.height > 0 && opt.complexity > 0 && opt.frames > 0;
+  }
+
+  /* peak resident set size in kilobytes */
+  long peakRSS()
+  {
+#ifdef WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+      return long(pmc.PeakWorkingSetSize / 1024);
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#endif
+  }
+
+  /* percentile in milliseconds of an already sorted list of frame times */
+  double percentile(const std::vector<float>& sorted, double p)
+  {
+    if (sorted.empty())
+      return 0;
+    size_t i = std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5));
+    return sorted[i] * 1000.0;
+  }
+
+  /* a grid of complexity x complexity rotating cubes, closing its window after a fixed number of frames */
+  class App_Benchmark: public Applet
+  {
+  public:
+    App_Benchmark(int complexity, int frames): mComplexity(complexity), mFrames(frames), mFrameCount(0) {}
+
+    void setWindow(vlGLFW::GLFW_window* window) { mWindow = window; }
+
+    virtual void initEvent()
+    {
+      ref<Effect> effect = new Effect;
+      effect->shader()->enable(EN_DEPTH_TEST);
+      effect->shader()->setRenderState( new Light, 0 );
+      effect->shader()->enable(EN_LIGHTING);
+
+      real spacing = 15;
+      real offset = (mComplexity - 1) * spacing / 2;
+      for (int i = 0; i < mComplexity; ++i)
+      {
+        for (int j = 0; j < mComplexity; ++j)
+        {
+          ref<Geometry> cube = makeBox( vec3(i * spacing - offset, j * spacing - offset, 0), 10, 10, 10 );
+          cube->computeNormals();
+
+          ref<Transform> transform = new Transform;
+          rendering()->as<Rendering>()->transform()->addChild( transform.get() );
+          Actor* actor = sceneManager()->tree()->addActor( cube.get(), effect.get(), transform.get() );
+          mTransforms.push_back(transform);
+          mCenters.push_back( vec3(i * spacing - offset, j * spacing - offset, 0) );
+
+          /* VL's renderer resets the binding's scissor, the actors carry the damage scissor instead */
+          if (mWindow->partialRedrawEnabled())
+            actor->setScissor( mWindow->damageScissor() );
+        }
+      }
+    }
+
+    virtual void updateScene()
+    {
+      real degrees = Time::currentTime() * 45.0f;
+      mat4 matrix = mat4::getRotation( degrees, 0,1,0 );
+
+      if (mWindow->partialRedrawEnabled())
+      {
+        /* one cube turns in place per frame and the next one's cell is marked dirty for the next frame */
+        size_t cube = mFrameCount % mTransforms.size();
+        vec3 c = mCenters[cube];
+        mTransforms[cube]->setLocalMatrix( mat4::getTranslation(c) * matrix * mat4::getTranslation(-c) );
+        markDirty( (mFrameCount + 1) % mTransforms.size() );
+
+        /* the viewport does not clear, this runs under the binding's scissor and clears the damaged region */
+        glClearColor(0.2f, 0.2f, 0.2f, 1);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      }
+      else
+      {
+        for (size_t i = 0; i < mTransforms.size(); ++i)
+          mTransforms[i]->setLocalMatrix( matrix );
+      }
+
+      if (++mFrameCount == mFrames)
+        mWindow->close();
+    }
+
+    /* marks the window region covered by a cube whatever its rotation */
+    void markDirty(size_t cube)
+    {
+      const real r = 9; /* bounding sphere of a 10 units cube, rounded up */
+      const Camera* camera = rendering()->as<Rendering>()->camera();
+      real x0 = 0, y0 = 0, x1 = -1, y1 = -1;
+
+      for (int k = 0; k < 8; ++k)
+      {
+        vec3 p = mCenters[cube] + vec3(k & 1 ? r : -r, k & 2 ? r : -r, k & 4 ? r : -r);
+        vec4 v;
+        if (!camera->project(vec4(p, 1), v))
+          return;
+        x0 = x1 < x0 ? v.x() : std::min(x0, v.x());
+        y0 = y1 < y0 ? v.y() : std::min(y0, v.y());
+        x1 = std::max(x1, v.x());
+        y1 = std::max(y1, v.y());
+      }
+
+      /* one pixel of margin for rasterization */
+      mWindow->addDirtyRect( int(x0) - 1, int(y0) - 1, int(x1 - x0) + 3, int(y1 - y0) + 3 );
+    }
+
+  protected:
+    int mComplexity;
+    int mFrames;
+    int mFrameCount;
+    vlGLFW::GLFW_window* mWindow;
+    std::vector< ref<Transform> > mTransforms;
+    std::vector<vec3> mCenters;
+  };
+
+  /* share of the pixels a full redraw would have touched, 100 without partial redraw */
+  double pixelsDrawnPercent(const vlGLFW::GLFW_window::DamageStats& d)
+  {
+    return d.pixelsFull ? 100.0 * d.pixelsDrawn / d.pixelsFull : 100.0;
+  }
+
+  struct instance_t
+  {
+    ref<App_Benchmark> applet;
+    ref<vlGLFW::GLFW_window> window;
+    std::vector<float> sorted;
+  };
+
+  void writeCSV(FILE* out, const options_t& opt, const std::vector<instance_t>& instances, double startup, double overhead, long rss, const vlGLFW::GLFW_window::LoopStats& loop)
+  {
+    fprintf(out, "window,windows,width,height,complexity,vsync,headless,frames,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,startup_ms,loop_overhead_us,peak_rss_kb,context_switches,partial_frames,pixels_drawn_pct\n");
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+      const std::vector<float>& t = instances[i].sorted;
+      double mean = 0;
+      for (size_t j = 0; j < t.size(); ++j)
+        mean += t[j];
+      mean = t.empty() ? 0 : mean * 1000.0 / t.size();
+
+      const vlGLFW::GLFW_window::DamageStats& d = instances[i].window->damageStats();
+      fprintf(out, "%d,%d,%d,%d,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.3f,%.3f,%ld,%llu,%llu,%.2f\n",
+              int(i), opt.windows, opt.width, opt.height, opt.complexity, opt.vsync, opt.headless, int(t.size()),
+              mean, percentile(t, 0.5), percentile(t, 0.9), percentile(t, 0.99), percentile(t, 1.0),
+              startup * 1000.0, overhead * 1e6, rss, loop.contextSwitches, d.partialFrames, pixelsDrawnPercent(d));
+    }
+  }
+
+  void writeJSON(FILE* out, const options_t& opt, const std::vector<instance_t>& instances, double startup, double overhead, long rss, const vlGLFW::GLFW_window::LoopStats& loop)
+  {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": { \"windows\": %d, \"width\": %d, \"height\": %d, \"complexity\": %d, \"frames\": %d, \"vsync\": %s, \"headless\": %s },\n",
+            opt.windows, opt.width, opt.height, opt.complexity, opt.frames, opt.vsync ? "true" : "false", opt.headless ? "true" : "false");
+    fprintf(out, "  \"startup_ms\": %.3f,\n", startup * 1000.0);
+    fprintf(out, "  \"loop_overhead_us\": %.3f,\n", overhead * 1e6);
+    fprintf(out, "  \"peak_rss_kb\": %ld,\n", rss);
+    fprintf(out, "  \"context_switches\": %llu,\n", loop.contextSwitches);
+    fprintf(out, "  \"windows\": [\n");
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+      const std::vector<float>& t = instances[i].sorted;
+      double mean = 0;
+      for (size_t j = 0; j < t.size(); ++j)
+        mean += t[j];
+      mean = t.empty() ? 0 : mean * 1000.0 / t.size();
+
+      const vlGLFW::GLFW_window::DamageStats& d = instances[i].window->damageStats();
+      fprintf(out, "    { \"window\": %d, \"frames\": %d, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"partial_frames\": %llu, \"pixels_drawn_pct\": %.2f }%s\n",
+              int(i), int(t.size()), mean, percentile(t, 0.5), percentile(t, 0.9), percentile(t, 0.99), percentile(t, 1.0),
+              d.partialFrames, pixelsDrawnPercent(d), i + 1 < instances.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+  }
+}
+
+int main(int argc, char* args[])
+{
+  options_t opt;
+  if (!parse(argc, args, opt))
+  {
+    usage();
+    return 1;
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  /* init Visualization Library */
+  VisualizationLibrary::init();
+
+  /* setup the OpenGL context format */
+  OpenGLContextFormat format;
+  format.setDoubleBuffer(true);
+  format.setRGBABits( 8,8,8,8 );
+  format.setDepthBufferBits(24);
+  format.setStencilBufferBits(8);
+  format.setFullscreen(false);
+  format.setVSync(opt.vsync);
+
+  std::vector<instance_t> instances(opt.windows);
+
+  int x = 0;
+  int y = 0;
+  for (int i = 0; i < opt.windows; ++i)
+  {
+    instances[i].applet = new App_Benchmark(opt.complexity, opt.frames);
+    instances[i].applet->initialize();
+
+    instances[i].window = new vlGLFW::GLFW_window;
+    instances[i].window->setStartHidden(opt.headless);
+    instances[i].window->setRecordFrameTimes(true);
+    instances[i].window->setPartialRedrawEnabled(opt.partial_redraw);
+    instances[i].applet->setWindow(instances[i].window.get());
+
+    instances[i].window->addEventListener(instances[i].applet.get());
+    instances[i].applet->rendering()->as<Rendering>()->renderer()->setFramebuffer(instances[i].window->framebuffer() );
+    instances[i].applet->rendering()->as<Rendering>()->camera()->viewport()->setClearColor( vl::fvec4(0.2f, 0.2f, 0.2f, 1) );
+    if (opt.partial_redraw)
+      instances[i].applet->rendering()->as<Rendering>()->camera()->viewport()->setClearFlags(CF_DO_NOT_CLEAR);
+
+    real distance = 35 + 15 * opt.complexity;
+    mat4 view_mat = mat4::getLookAt(vec3(0,10,distance), vec3(0,0,0), vec3(0,1,0));
+    instances[i].applet->rendering()->as<Rendering>()->camera()->setViewMatrix( view_mat );
+
+    if ( !instances[i].window->initGLFW_window("Visualization Library on GLFW - Benchmark", format, x, y, opt.width, opt.height) )
+    {
+      fprintf(stderr, "GLFW_benchmark: could not create window %d\n", i);
+      return 1;
+    }
+
+    x = (x + 30) % 600;
+    y = (y + 30) % 400;
+  }
+
+  double startup = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  /* run GLFW message loop until every window rendered its frames */
+  vlGLFW::GLFW_window::eventLoop();
+
+  const vlGLFW::GLFW_window::LoopStats& loop = vlGLFW::GLFW_window::loopStats();
+  double overhead = loop.frames ? (loop.time - loop.frameTime) / loop.frames : 0;
+  long rss = peakRSS();
+
+  for (size_t i = 0; i < instances.size(); ++i)
+  {
+    instances[i].sorted = instances[i].window->frameTimes();
+    std::sort(instances[i].sorted.begin(), instances[i].sorted.end());
+  }
+
+  FILE* out = opt.output ? fopen(opt.output, "w") : stdout;
+  if (!out)
+  {
+    fprintf(stderr, "GLFW_benchmark: cannot write %s\n", opt.output);
+    return 1;
+  }
+
+  if (opt.json)
+    writeJSON(out, opt, instances, startup, overhead, rss, loop);
+  else
+    writeCSV(out, opt, instances, startup, overhead, rss, loop);
+
+  if (out != stdout)
+    fclose(out);
+
+  instances.clear();
+
+  /* shutdown Visualization Library */
+  VisualizationLibrary::shutdown();
+
+  return 0;
+}
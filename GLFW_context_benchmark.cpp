@@ -0,0 +1,229 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2016, Michele Bosi, John Lagerquist                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+// Compares the per-draw-call CPU overhead of the default context created by GLFW_window
+// with the lean no-error core profile enabled by GLFW_window::setPerformanceProfile(),
+// then measures the cost of switching contexts as the number of windows grows.
+//
+// usage: GLFW_context_benchmark [draw_calls] [switch_passes]
+
+#include <vlCore/VisualizationLibrary.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+#include <vlGraphics/OpenGL.hpp>
+#include <vlGLFW/GLFW_window.hpp>
+#include <cstdlib>
+#include <vector>
+
+using namespace vl;
+
+namespace
+{
+  const char* vs_core =
+    "#version 330 core\n"
+    "layout(location = 0) in vec2 position;\n"
+    "uniform float offset;\n"
+    "void main() { gl_Position = vec4(position.x + offset, position.y, 0.0, 1.0); }\n";
+
+  const char* fs_core =
+    "#version 330 core\n"
+    "out vec4 color;\n"
+    "void main() { color = vec4(1.0); }\n";
+
+  const char* vs_compat =
+    "#version 130\n"
+    "in vec2 position;\n"
+    "uniform float offset;\n"
+    "void main() { gl_Position = vec4(position.x + offset, position.y, 0.0, 1.0); }\n";
+
+  const char* fs_compat =
+    "#version 130\n"
+    "out vec4 color;\n"
+    "void main() { color = vec4(1.0); }\n";
+
+  GLuint compile(GLenum type, const char* source)
+  {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    return shader;
+  }
+
+  /* returns the average CPU time of a uniform update plus a draw call, in nanoseconds */
+  double measure(bool performance_profile, int draw_calls)
+  {
+    OpenGLContextFormat format;
+    format.setDoubleBuffer(true);
+    format.setRGBABits( 8,8,8,8 );
+    format.setDepthBufferBits(24);
+    format.setStencilBufferBits(8);
+
+    ref<vlGLFW::GLFW_window> window = new vlGLFW::GLFW_window;
+    window->setPerformanceProfile(performance_profile);
+    if ( !window->initGLFW_window("Visualization Library on GLFW - Context Benchmark", format, 100, 100, 64, 64) )
+      return -1;
+    window->makeCurrent();
+
+    GLuint program = glCreateProgram();
+    GLuint vs = compile(GL_VERTEX_SHADER, performance_profile ? vs_core : vs_compat);
+    GLuint fs = compile(GL_FRAGMENT_SHADER, performance_profile ? fs_core : fs_compat);
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glBindAttribLocation(program, 0, "position");
+    glLinkProgram(program);
+    glUseProgram(program);
+    GLint offset = glGetUniformLocation(program, "offset");
+
+    const GLfloat triangle[] = { -0.1f, -0.1f, 0.1f, -0.1f, 0.0f, 0.1f };
+    GLuint vao, vbo;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+
+    /* warm up so shader compilation and buffer uploads are not measured */
+    for (int i = 0; i < 1000; ++i)
+    {
+      glUniform1f(offset, (i % 10) * 0.01f);
+      glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glFinish();
+
+    double start = glfwGetTime();
+    for (int i = 0; i < draw_calls; ++i)
+    {
+      glUniform1f(offset, (i % 10) * 0.01f);
+      glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glFinish();
+    double elapsed = glfwGetTime() - start;
+
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    glDeleteProgram(program);
+
+    if ( performance_profile )
+    {
+      const vlGLFW::GLFW_window::ContextProfile& p = window->contextProfile();
+      Log::print( Say("performance profile: OpenGL %n.%n %s, no_error %s, depth %n, stencil %n, samples %n\n")
+                  << p.major << p.minor << (p.core ? "core" : "compatibility") << (p.noError ? "on" : "off")
+                  << p.depthBits << p.stencilBits << p.samples );
+    }
+
+    return elapsed * 1e9 / draw_calls;
+  }
+
+  /* returns the average time of making a window's context current and clearing it, in microseconds */
+  double measureSwitches(int windows, int passes)
+  {
+    OpenGLContextFormat format;
+    format.setDoubleBuffer(true);
+    format.setRGBABits( 8,8,8,8 );
+
+    std::vector< ref<vlGLFW::GLFW_window> > list;
+    for (int i = 0; i < windows; ++i)
+    {
+      ref<vlGLFW::GLFW_window> window = new vlGLFW::GLFW_window;
+      window->setStartHidden(true);
+      if ( !window->initGLFW_window("Visualization Library on GLFW - Context Benchmark", format, 0, 0, 64, 64) )
+        return -1;
+      list.push_back(window);
+    }
+
+    const vlGLFW::GLFW_window::LoopStats& stats = vlGLFW::GLFW_window::loopStats();
+    unsigned long long switches = stats.contextSwitches;
+    unsigned long long skipped = stats.redundantSwitches;
+
+    double start = glfwGetTime();
+    for (int p = 0; p < passes; ++p)
+    {
+      for (int i = 0; i < windows; ++i)
+      {
+        list[i]->makeCurrent();
+        glClear(GL_COLOR_BUFFER_BIT);
+      }
+    }
+    for (int i = 0; i < windows; ++i)
+    {
+      list[i]->makeCurrent();
+      glFinish();
+    }
+    double elapsed = glfwGetTime() - start;
+
+    Log::print( Say("%n windows: %n context switches, %n skipped, %.2n us per window\n")
+                << windows << stats.contextSwitches - switches << stats.redundantSwitches - skipped
+                << elapsed * 1e6 / (double(passes) * windows) );
+
+    return elapsed * 1e6 / (double(passes) * windows);
+  }
+}
+
+int main(int argc, char* args[])
+{
+  int draw_calls = argc > 1 ? std::atoi(args[1]) : 200000;
+  if (draw_calls <= 0)
+    draw_calls = 200000;
+
+  int passes = argc > 2 ? std::atoi(args[2]) : 2000;
+  if (passes <= 0)
+    passes = 2000;
+
+  /* init Visualization Library */
+  VisualizationLibrary::init();
+
+  double default_ns = measure(false, draw_calls);
+  double lean_ns = measure(true, draw_calls);
+
+  Log::print( Say("%n draw calls\n") << draw_calls );
+  Log::print( Say("default context:     %.1n ns per draw call\n") << default_ns );
+  Log::print( Say("performance profile: %.1n ns per draw call\n") << lean_ns );
+  if (default_ns > 0 && lean_ns > 0)
+    Log::print( Say("speedup: %.2nx\n") << default_ns / lean_ns );
+
+  /* a single window never switches, the difference with it is the cost of a switch */
+  double single_us = measureSwitches(1, passes);
+  for (int windows = 2; windows <= 16; windows *= 2)
+  {
+    double us = measureSwitches(windows, passes);
+    if (single_us > 0 && us > 0)
+      Log::print( Say("  switch cost with %n windows: %.2n us\n") << windows << us - single_us );
+  }
+
+  /* shutdown Visualization Library */
+  VisualizationLibrary::shutdown();
+
+  return 0;
+}
@@ -36,6 +36,8 @@
 #include "vlCore/Log.hpp"
 #include "vlCore/Say.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <unordered_map>
 #include <vector>
 
@@ -43,6 +45,13 @@
 #include <shellapi.h>
 #endif
 
+#ifdef VLGLFW_USE_EGL
+#define GLFW_EXPOSE_NATIVE_EGL
+#include <GLFW/glfw3native.h>
+#include <EGL/eglext.h>
+#include <string>
+#endif
+
 using namespace vlGLFW;
 using namespace vl;
 
@@ -149,8 +158,240 @@ static std::unordered_map<uint32_t, vl::EKey> key_translation_map =
     { (GLFW_MOD_SHIFT << 16) | GLFW_KEY_6, vl::Key_Caret },
     { (GLFW_MOD_SHIFT << 16) | GLFW_KEY_MINUS, vl::Key_Underscore }
 };
+
+// how many past frames of damage are kept to repair back buffers of age > 1
+const size_t max_damage_history = 4;
+
+bool rectEmpty( const RectI& r )
+{
+    return r.width() <= 0 || r.height() <= 0;
+}
+
+RectI rectUnion( const RectI& a, const RectI& b )
+{
+    if ( rectEmpty(a) )
+        return b;
+    if ( rectEmpty(b) )
+        return a;
+
+    int x0 = std::min(a.x(), b.x());
+    int y0 = std::min(a.y(), b.y());
+    int x1 = std::max(a.x() + a.width(), b.x() + b.width());
+    int y1 = std::max(a.y() + a.height(), b.y() + b.height());
+    return RectI(x0, y0, x1 - x0, y1 - y0);
+}
+
+RectI rectIntersection( const RectI& a, const RectI& b )
+{
+    int x0 = std::max(a.x(), b.x());
+    int y0 = std::max(a.y(), b.y());
+    int x1 = std::min(a.x() + a.width(), b.x() + b.width());
+    int y1 = std::min(a.y() + a.height(), b.y() + b.height());
+    if ( x1 <= x0 || y1 <= y0 )
+        return RectI(0, 0, 0, 0);
+    return RectI(x0, y0, x1 - x0, y1 - y0);
+}
+
+// the context current on this thread as far as GLFW_window::makeCurrent() knows, thread_local like the GL
+// binding itself even though makeCurrent() and its counters are main thread only
+thread_local GLFWwindow* current_context = nullptr;
+
+unsigned long long rectArea( const RectI& r )
+{
+    return rectEmpty(r) ? 0 : (unsigned long long)r.width() * r.height();
+}
+
+// debug messages forwarded to vl::Log per window and frame, the rest is only counted
+const unsigned max_debug_messages_per_frame = 8;
+
+// seconds before a repeated debug message is logged again
+const double debug_repeat_interval = 1.0;
+
+// bits of a default framebuffer attachment, 0 if the framebuffer has none
+GLint attachmentBits( GLenum attachment, GLenum size_param )
+{
+    GLint type = GL_NONE;
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+    if ( type == GL_NONE )
+        return 0;
+
+    GLint bits = 0;
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, attachment, size_param, &bits);
+    return bits;
+}
+
+// queries the current GL context, unlike glfwExtensionSupported() which needs GLFW's current context
+bool hasGLExtension( const char* name )
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    if ( glGetError() == GL_NO_ERROR && count > 0 )
+    {
+        for ( GLint i = 0; i < count; ++i )
+        {
+            const GLubyte* ext = glGetStringi(GL_EXTENSIONS, GLuint(i));
+            if ( ext && strcmp(reinterpret_cast<const char*>(ext), name) == 0 )
+                return true;
+        }
+        return false;
+    }
+
+    // pre 3.0 contexts only have the space separated list
+    const char* list = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    size_t len = strlen(name);
+    for ( const char* p = list; p && (p = strstr(p, name)) != nullptr; p += len )
+    {
+        if ( (p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0') )
+            return true;
+    }
+    return false;
 }
 
+const char* debugSourceName( GLenum source )
+{
+    switch ( source )
+    {
+    case GL_DEBUG_SOURCE_API:             return "api";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY:     return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION:     return "application";
+    default:                              return "other";
+    }
+}
+
+const char* debugTypeName( GLenum type )
+{
+    switch ( type )
+    {
+    case GL_DEBUG_TYPE_ERROR:               return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined behavior";
+    case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+    case GL_DEBUG_TYPE_MARKER:              return "marker";
+    default:                                return "other";
+    }
+}
+}
+
+//-----------------------------------------------------------------------------
+// DebugOutput
+//-----------------------------------------------------------------------------
+// Multiple-producer single-consumer ring: the driver may invoke the callback from any thread,
+// the main thread drains it on every event loop pass.
+struct vlGLFW::GLFW_window::DebugOutput
+{
+    struct Entry
+    {
+        GLenum source;
+        GLenum type;
+        GLuint id;
+        GLenum severity;
+        char text[256];
+    };
+
+    struct Slot
+    {
+        Entry entry;
+        std::atomic<bool> ready { false };
+    };
+
+    struct Filter
+    {
+        GLenum source;
+        GLenum type;
+        GLenum severity;
+        bool enabled;
+    };
+
+    struct Repeat
+    {
+        double lastLogged = -debug_repeat_interval;
+        unsigned long long pending = 0;
+        Entry last;
+    };
+
+    static const unsigned ring_size = 256;
+
+    static void APIENTRY callback( GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user )
+    {
+        static_cast<DebugOutput*>(const_cast<void*>(user))->push(source, type, id, severity, length, message);
+    }
+
+    void push( GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message )
+    {
+        unsigned h = head.load(std::memory_order_relaxed);
+        do
+        {
+            if ( h - tail.load(std::memory_order_acquire) >= ring_size )
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        while ( !head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel, std::memory_order_relaxed) );
+
+        Slot& slot = ring[h % ring_size];
+        slot.entry.source = source;
+        slot.entry.type = type;
+        slot.entry.id = id;
+        slot.entry.severity = severity;
+
+        size_t n = length < 0 ? strlen(message) : size_t(length);
+        n = std::min(n, sizeof(slot.entry.text) - 1);
+        memcpy(slot.entry.text, message, n);
+        slot.entry.text[n] = 0;
+
+        slot.ready.store(true, std::memory_order_release);
+    }
+
+    bool pop( Entry& entry )
+    {
+        unsigned t = tail.load(std::memory_order_relaxed);
+        if ( t == head.load(std::memory_order_acquire) )
+            return false;
+
+        // reserved by a producer that has not finished writing it yet
+        Slot& slot = ring[t % ring_size];
+        if ( !slot.ready.load(std::memory_order_acquire) )
+            return false;
+
+        entry = slot.entry;
+        slot.ready.store(false, std::memory_order_relaxed);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    Slot ring[ring_size];
+    std::atomic<unsigned> head { 0 };
+    std::atomic<unsigned> tail { 0 };
+    std::atomic<unsigned long long> dropped { 0 };
+
+    static void log( const Entry& e, unsigned long long repeated )
+    {
+        String msg = Say("vlGLFW GL %s %s %n: %s") << debugSourceName(e.source) << debugTypeName(e.type) << e.id << e.text;
+        if ( repeated )
+            msg = msg + (Say(" (repeated %n times)") << repeated);
+        msg = msg + "\n";
+
+        if ( e.severity == GL_DEBUG_SEVERITY_HIGH )
+            Log::error(msg);
+        else if ( e.severity == GL_DEBUG_SEVERITY_MEDIUM || e.type == GL_DEBUG_TYPE_PERFORMANCE )
+            Log::warning(msg);
+        else
+            Log::print(msg);
+    }
+
+    std::vector<Filter> filters;
+    std::unordered_map<unsigned long long, Repeat> repeats;
+    unsigned long long pending = 0;
+    bool newFrame = false;
+    unsigned long long performanceSummary = 0;
+    double performanceLogged = -debug_repeat_interval;
+    DebugStats stats;
+};
+
 //-----------------------------------------------------------------------------
 vlGLFW::GLFW_window::GLFW_window()
 {
@@ -158,6 +399,9 @@ vlGLFW::GLFW_window::GLFW_window()
 //-----------------------------------------------------------------------------
 vlGLFW::GLFW_window::~GLFW_window()
 {
+    // waits for the files still being read, no worker may post events once GLFW is terminated
+    mDropLoader.reset();
+
     lock();
 
     if ( window )
@@ -166,14 +410,19 @@ vlGLFW::GLFW_window::~GLFW_window()
 
         if ( f != GLFW_windowList.cend() )
         {
+            // the destroy listeners release GL objects of this window's context
+            makeCurrent();
             dispatchDestroyEvent();
-            glfwDestroyWindow(window);
+            destroyWindow();
             GLFW_windowList.erase(f);
         }
     }
 
     if ( GLFW_windowList.empty() )
+    {
+        MonitorTopology::instance().uninstall();
         glfwTerminate();
+    }
 
     unlock();
 }
@@ -207,18 +456,54 @@ bool vlGLFW::GLFW_window::initGLFW_window( const vl::String& title, const vl::Op
     glfwWindowHint(GLFW_BLUE_BITS, info.rgbaBits().b());
     glfwWindowHint(GLFW_ALPHA_BITS, info.rgbaBits().a());
 
-    glfwWindowHint(GLFW_ACCUM_RED_BITS, info.accumRGBABits().r());
-    glfwWindowHint(GLFW_ACCUM_GREEN_BITS, info.accumRGBABits().g());
-    glfwWindowHint(GLFW_ACCUM_BLUE_BITS, info.accumRGBABits().b());
-    glfwWindowHint(GLFW_ACCUM_ALPHA_BITS, info.accumRGBABits().a());
-
     glfwWindowHint(GLFW_DEPTH_BITS, info.depthBufferBits());
     glfwWindowHint(GLFW_STENCIL_BITS, info.stencilBufferBits());
 
     glfwWindowHint(GLFW_DOUBLEBUFFER, info.doubleBuffer() ? GL_TRUE : GL_FALSE);
-    glfwWindowHint(GLFW_STEREO, info.stereo());
     glfwWindowHint(GLFW_SAMPLES, info.multisample() ? info.multisampleSamples() : 0);
-    glfwSwapInterval(info.vSync() ? 1 : 0);
+
+    if ( mPerformanceProfile )
+    {
+        // core profile without driver-side error checking, no accumulation or stereo buffers
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, mProfileMajor);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, mProfileMinor);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        // a debug context cannot be a no-error context
+        glfwWindowHint(GLFW_CONTEXT_NO_ERROR, mDebugContext ? GL_FALSE : GL_TRUE);
+        glfwWindowHint(GLFW_ACCUM_RED_BITS, 0);
+        glfwWindowHint(GLFW_ACCUM_GREEN_BITS, 0);
+        glfwWindowHint(GLFW_ACCUM_BLUE_BITS, 0);
+        glfwWindowHint(GLFW_ACCUM_ALPHA_BITS, 0);
+        glfwWindowHint(GLFW_STEREO, GL_FALSE);
+    }
+    else
+    {
+        // hints persist across glfwCreateWindow() calls, undo a previous performance profile
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 1);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_ANY_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_NO_ERROR, GL_FALSE);
+
+        glfwWindowHint(GLFW_ACCUM_RED_BITS, info.accumRGBABits().r());
+        glfwWindowHint(GLFW_ACCUM_GREEN_BITS, info.accumRGBABits().g());
+        glfwWindowHint(GLFW_ACCUM_BLUE_BITS, info.accumRGBABits().b());
+        glfwWindowHint(GLFW_ACCUM_ALPHA_BITS, info.accumRGBABits().a());
+        glfwWindowHint(GLFW_STEREO, info.stereo());
+    }
+
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, mDebugContext ? GL_TRUE : GL_FALSE);
+
+#ifdef VLGLFW_USE_EGL
+    // GLFW defaults to GLX and WGL on X11 and Windows, swap with damage and buffer age are EGL only
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+#endif
+
+    MonitorTopology& topology = MonitorTopology::instance();
+    topology.install();
+
+    glfwWindowHint(GLFW_REFRESH_RATE, GLFW_DONT_CARE);
 
     if ( info.fullscreen() )
     {
@@ -226,10 +511,43 @@ bool vlGLFW::GLFW_window::initGLFW_window( const vl::String& title, const vl::Op
         // if the user requested full screen get the primary monitor
         if ( !monitor )
             monitor = glfwGetPrimaryMonitor();
+
+        // a stubbed list does not know the GLFW handles, its first monitor stands for the primary one
+        const MonitorTopology::Monitor* m = topology.find(monitor);
+        if ( !m && monitor == glfwGetPrimaryMonitor() )
+            m = topology.primary();
+
+        if ( m )
+        {
+            if ( mBorderlessFullscreen )
+            {
+                // matching the current mode makes GLFW keep it instead of switching
+                glfwWindowHint(GLFW_RED_BITS, m->current.redBits);
+                glfwWindowHint(GLFW_GREEN_BITS, m->current.greenBits);
+                glfwWindowHint(GLFW_BLUE_BITS, m->current.blueBits);
+                glfwWindowHint(GLFW_REFRESH_RATE, m->current.refreshRate);
+                width = m->current.width;
+                height = m->current.height;
+            }
+            else if ( const MonitorTopology::VideoMode* mode = MonitorTopology::bestMode(*m, width, height) )
+            {
+                glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
+                width = mode->width;
+                height = mode->height;
+            }
+        }
     }
 
     // Create a windowed mode window and its OpenGL context
     window = glfwCreateWindow(width, height, title.toStdString().c_str(), monitor, share);
+#ifdef VLGLFW_USE_EGL
+    if ( !window )
+    {
+        Log::warning("vlGLFW: could not create an EGL context, falling back to the native context API.\n");
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+        window = glfwCreateWindow(width, height, title.toStdString().c_str(), monitor, share);
+    }
+#endif
     if ( !window )
     {
         if ( GLFW_windowList.empty() )
@@ -251,6 +569,8 @@ bool vlGLFW::GLFW_window::initGLFW_window( const vl::String& title, const vl::Op
     // OpenGL extensions initialization
     glfwGetFramebufferSize(window, &width, &height);
 
+    // a new context is not current, VL needs it to load the extensions
+    makeCurrent();
     initGLContext();
     dispatchInitEvent();
     dispatchResizeEvent(width, height);
@@ -259,7 +579,8 @@ bool vlGLFW::GLFW_window::initGLFW_window( const vl::String& title, const vl::Op
     glfwSetWindowPos(window, x, y);
 
     // show the window
-    glfwShowWindow(window);
+    if ( !mStartHidden )
+        glfwShowWindow(window);
 
     framebuffer()->setWidth(width);
     framebuffer()->setHeight(height);
@@ -276,34 +597,545 @@ bool vlGLFW::GLFW_window::initGLFW_window( const vl::String& title, const vl::Op
     glfwSetDropCallback(window, dropCallback);
     glfwSetWindowCloseCallback(window, closeCallback);
     glfwSetFramebufferSizeCallback(window, resizeCallback);
+    glfwSetWindowIconifyCallback(window, iconifyCallback);
+    glfwSetWindowFocusCallback(window, focusCallback);
+
+    mIconified = glfwGetWindowAttrib(window, GLFW_ICONIFIED) != 0;
+    mFocused = glfwGetWindowAttrib(window, GLFW_FOCUSED) != 0;
+    mHidden = glfwGetWindowAttrib(window, GLFW_VISIBLE) == 0;
+    mStateSince = glfwGetTime();
+    updateWindowState();
 
-    glfwMakeContextCurrent(window);
     resizeCallback(window, width, height);
 
+    // the swap interval applies to the current context
+    glfwSwapInterval(info.vSync() ? 1 : 0);
+
+    initDamageExtensions();
+
+    if ( mPerformanceProfile )
+        verifyPerformanceProfile(info);
+
+    if ( mDebugContext )
+        initDebugOutput();
+
     return true;
 }
 
 //-----------------------------------------------------------------------------
 void vlGLFW::GLFW_window::eventLoop( void )
 {
+    double start = glfwGetTime();
+    std::vector<GLFW_window*> pass;
+    bool reverse = false;
+
     while ( !GLFW_windowList.empty() )
     {
-        for ( auto iter = GLFW_windowList.begin(); iter != GLFW_windowList.end(); ++iter )
+        bool rendered = false;
+        ++eventLoopStats.iterations;
+
+        // walk the windows back and forth so the last context made current in a pass is
+        // the first one needed by the next, saving one switch per pass
+        pass.assign(GLFW_windowList.begin(), GLFW_windowList.end());
+        if ( reverse )
+            std::reverse(pass.begin(), pass.end());
+        reverse = !reverse;
+
+        for ( GLFW_window* w : pass )
         {
             glfwPollEvents();
 
-            if ( glfwWindowShouldClose((*iter)->window) )
+            // an event handler may have destroyed the window
+            auto iter = std::find(GLFW_windowList.begin(), GLFW_windowList.end(), w);
+            if ( iter == GLFW_windowList.end() )
+                continue;
+
+            if ( glfwWindowShouldClose(w->window) )
             {
-				(*iter)->dispatchDestroyEvent();
-				glfwDestroyWindow((*iter)->window);
-				(*iter)->window = 0;
-				GLFW_windowList.erase(iter);
-                break;
+                if ( w->mDropLoader )
+                    w->mDropLoader->cancel();
+                w->makeCurrent();
+                w->dispatchDestroyEvent();
+                w->destroyWindow();
+                GLFW_windowList.erase(iter);
+                continue;
+            }
+
+            w->updateVisibility();
+
+            // files loaded in the background are handed over even while the window does not render
+            if ( w->mDropLoader )
+                w->mDropLoader->deliver();
+
+            if ( w->nextFrameDelay(glfwGetTime()) == 0 )
+            {
+                w->makeCurrent();
+                rendered |= w->renderFrame();
             }
-            (*iter)->dispatchRunEvent();
+
+            // paused and throttled windows drain their debug messages too
+            if ( w->mDebugOutput )
+                w->flushDebugOutput();
+        }
+
+        if ( rendered )
+            continue;
+
+        // the last window was closed during this pass, there is nothing left to wait for
+        if ( GLFW_windowList.empty() )
+            break;
+
+        // every window is paused or throttled: sleep until the next frame is due or an event arrives
+        double now = glfwGetTime();
+        double delay = -1;
+        for ( auto w : GLFW_windowList )
+        {
+            double d = w->nextFrameDelay(now);
+            if ( d >= 0 && (delay < 0 || d < delay) )
+                delay = d;
+
+            // wake up to report the debug message repeats that are due
+            d = w->debugFlushDelay(now);
+            if ( d >= 0 && (delay < 0 || d < delay) )
+                delay = d;
+        }
+
+        if ( delay < 0 )
+            glfwWaitEvents();
+        else if ( delay > 0 )
+            glfwWaitEventsTimeout(delay);
+    }
+
+    eventLoopStats.time += glfwGetTime() - start;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::makeCurrent()
+{
+    if ( current_context == window )
+    {
+        ++eventLoopStats.redundantSwitches;
+        return;
+    }
+
+    glfwMakeContextCurrent(window);
+    current_context = window;
+    ++eventLoopStats.contextSwitches;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::syncCurrentContext()
+{
+    current_context = glfwGetCurrentContext();
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::destroyWindow()
+{
+    // the driver must not call back into mDebugOutput once it is freed
+    if ( mDebugOutput )
+    {
+        makeCurrent();
+        glDebugMessageCallback(nullptr, nullptr);
+    }
+
+    // GLFW detaches the context if it is current on this thread
+    if ( current_context == window )
+        current_context = nullptr;
+
+    glfwDestroyWindow(window);
+    window = nullptr;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::updateVisibility( void )
+{
+    bool hidden = glfwGetWindowAttrib(window, GLFW_VISIBLE) == 0;
+    if ( hidden == mHidden )
+        return;
+
+    mHidden = hidden;
+    updateWindowState();
+    dispatchVisibilityEvent(!mHidden && !mIconified);
+
+    // like an iconified window, a hidden one may have lost its back buffer
+    if ( !mHidden )
+        invalidate();
+}
+//-----------------------------------------------------------------------------
+double vlGLFW::GLFW_window::nextFrameDelay( double now ) const
+{
+    // with damage tracking a frame is only due once something was marked dirty
+    if ( mPartialRedraw && !mFullDamage && rectEmpty(mPendingDamage) )
+        return -1;
+
+    switch ( mWindowState )
+    {
+    case WS_Iconified:
+        return mInactivePolicy == IP_FullRate ? 0 : -1;
+
+    case WS_Unfocused:
+        if ( mInactivePolicy == IP_ReduceUnfocused && mUnfocusedFrameRate > 0 )
+            return std::max(0.0, mLastFrame + 1.0 / mUnfocusedFrameRate - now);
+        return 0;
+
+    default:
+        return 0;
+    }
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::updateWindowState( void )
+{
+    EWindowState state = mIconified || mHidden ? WS_Iconified : mFocused ? WS_Active : WS_Unfocused;
+    if ( state == mWindowState )
+        return;
+
+    double now = glfwGetTime();
+    mStateTime[mWindowState] += now - mStateSince;
+    mStateSince = now;
+    mWindowState = state;
+}
+//-----------------------------------------------------------------------------
+double vlGLFW::GLFW_window::timeInState( EWindowState state ) const
+{
+    double t = mStateTime[state];
+    if ( state == mWindowState )
+        t += glfwGetTime() - mStateSince;
+    return t;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::logStateTimes() const
+{
+    Log::print( Say("vlGLFW window \"%s\": active %.1ns (%n frames), unfocused %.1ns (%n frames), iconified %.1ns (%n frames)\n")
+                << mTitle
+                << timeInState(WS_Active) << mStateFrames[WS_Active]
+                << timeInState(WS_Unfocused) << mStateFrames[WS_Unfocused]
+                << timeInState(WS_Iconified) << mStateFrames[WS_Iconified] );
+}
+
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::verifyPerformanceProfile( const vl::OpenGLContextFormat& info )
+{
+    ContextProfile& p = mContextProfile;
+
+    p.major = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MAJOR);
+    p.minor = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MINOR);
+    p.core = glfwGetWindowAttrib(window, GLFW_OPENGL_PROFILE) == GLFW_OPENGL_CORE_PROFILE;
+    p.noError = glfwGetWindowAttrib(window, GLFW_CONTEXT_NO_ERROR) != 0;
+
+    // GLFW does not report the framebuffer configuration, ask the default framebuffer directly; the size of a
+    // missing attachment is an error, i.e. undefined behavior on a no-error context, so check it exists first
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    p.depthBits = attachmentBits(GL_DEPTH, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE);
+    p.stencilBits = attachmentBits(GL_STENCIL, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE);
+    glGetIntegerv(GL_SAMPLES, &p.samples);
+
+    if ( !p.core || p.major < mProfileMajor || (p.major == mProfileMajor && p.minor < mProfileMinor) )
+        Log::warning( Say("vlGLFW: requested an OpenGL %n.%n core profile, got %n.%n %s.\n")
+                      << mProfileMajor << mProfileMinor << p.major << p.minor << (p.core ? "core" : "compatibility") );
+    if ( !p.noError )
+        Log::warning("vlGLFW: KHR_no_error was not granted, the driver still validates every call.\n");
+    if ( p.depthBits < info.depthBufferBits() || p.stencilBits < info.stencilBufferBits() )
+        Log::warning( Say("vlGLFW: requested %n depth and %n stencil bits, got %n and %n.\n")
+                      << info.depthBufferBits() << info.stencilBufferBits() << p.depthBits << p.stencilBits );
+}
+//-----------------------------------------------------------------------------
+bool vlGLFW::GLFW_window::renderFrame( void )
+{
+    double start = glfwGetTime();
+
+    if ( mPartialRedraw )
+    {
+        if ( !renderDamaged() )
+            return false;
+    }
+    else
+        dispatchRunEvent();
+
+    mLastFrame = start;
+    if ( mDebugOutput )
+        mDebugOutput->newFrame = true;
+    ++mStateFrames[mWindowState];
+
+    double elapsed = glfwGetTime() - start;
+    eventLoopStats.frameTime += elapsed;
+    ++eventLoopStats.frames;
+    if ( mRecordFrameTimes )
+        mFrameTimes.push_back(float(elapsed));
+    return true;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::setDebugContext( bool enabled )
+{
+    mDebugContext = enabled;
+
+    if ( enabled && !mDebugOutput )
+        mDebugOutput.reset(new DebugOutput);
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::addDebugFilter( GLenum source, GLenum type, GLenum severity, bool enabled )
+{
+    if ( !mDebugOutput )
+        mDebugOutput.reset(new DebugOutput);
+
+    mDebugOutput->filters.push_back({ source, type, severity, enabled });
+
+    if ( window && mDebugContext )
+        glDebugMessageControl(source, type, severity, 0, nullptr, enabled ? GL_TRUE : GL_FALSE);
+}
+//-----------------------------------------------------------------------------
+const vlGLFW::GLFW_window::DebugStats& vlGLFW::GLFW_window::debugStats() const
+{
+    static const DebugStats none;
+    return mDebugOutput ? mDebugOutput->stats : none;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::initDebugOutput( void )
+{
+    if ( !hasGLExtension("GL_KHR_debug") )
+    {
+        Log::warning("vlGLFW: GL_KHR_debug is not supported, debug output disabled.\n");
+        return;
+    }
+
+    if ( !glfwGetWindowAttrib(window, GLFW_OPENGL_DEBUG_CONTEXT) )
+        Log::warning("vlGLFW: a debug context was not granted, the driver may report fewer messages.\n");
+
+    if ( !mDebugOutput )
+        mDebugOutput.reset(new DebugOutput);
+
+    glEnable(GL_DEBUG_OUTPUT);
+    glDebugMessageCallback(DebugOutput::callback, mDebugOutput.get());
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+
+    for ( const DebugOutput::Filter& f : mDebugOutput->filters )
+        glDebugMessageControl(f.source, f.type, f.severity, 0, nullptr, f.enabled ? GL_TRUE : GL_FALSE);
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::flushDebugOutput( void )
+{
+    DebugOutput& d = *mDebugOutput;
+    double now = glfwGetTime();
+    unsigned performance = 0;
+    unsigned logged = 0;
+    DebugOutput::Entry e;
+
+    while ( d.pop(e) )
+    {
+        ++d.stats.messages;
+        if ( e.type == GL_DEBUG_TYPE_PERFORMANCE )
+            ++performance;
+
+        unsigned long long key = ((unsigned long long)e.id << 32) | ((e.source & 0xFFFF) << 16) | (e.type & 0xFFFF);
+        DebugOutput::Repeat& r = d.repeats[key];
+
+        if ( now - r.lastLogged < debug_repeat_interval || logged >= max_debug_messages_per_frame )
+        {
+            r.last = e;
+            ++r.pending;
+            ++d.pending;
+            ++d.stats.suppressed;
+            continue;
         }
+
+        DebugOutput::log(e, r.pending);
+        d.pending -= r.pending;
+        r.lastLogged = now;
+        r.pending = 0;
+        ++logged;
+    }
+
+    // report the repeats that did not come back once their interval is over
+    for ( auto it = d.repeats.begin(); d.pending && it != d.repeats.end() && logged < max_debug_messages_per_frame; ++it )
+    {
+        DebugOutput::Repeat& r = it->second;
+        if ( !r.pending || now - r.lastLogged < debug_repeat_interval )
+            continue;
+
+        DebugOutput::log(r.last, r.pending);
+        d.pending -= r.pending;
+        r.lastLogged = now;
+        r.pending = 0;
+        ++logged;
+    }
+
+    d.stats.dropped = d.dropped.load(std::memory_order_relaxed);
+    d.stats.performance += performance;
+
+    // the messages of a frame are drained in the event loop pass that rendered it
+    if ( d.newFrame )
+    {
+        d.stats.performanceLastFrame = 0;
+        d.newFrame = false;
+    }
+    d.stats.performanceLastFrame += performance;
+
+    // the summary is rate limited like the messages themselves
+    d.performanceSummary += performance;
+    if ( d.performanceSummary && now - d.performanceLogged >= debug_repeat_interval )
+    {
+        Log::warning( Say("vlGLFW: window \"%s\" got %n driver performance messages since the last summary.\n")
+                      << mTitle << d.performanceSummary );
+        d.performanceSummary = 0;
+        d.performanceLogged = now;
     }
 }
+//-----------------------------------------------------------------------------
+double vlGLFW::GLFW_window::debugFlushDelay( double now ) const
+{
+    if ( !mDebugOutput )
+        return -1;
+
+    double delay = -1;
+    if ( mDebugOutput->performanceSummary )
+        delay = std::max(0.0, mDebugOutput->performanceLogged + debug_repeat_interval - now);
+
+    if ( !mDebugOutput->pending )
+        return delay;
+
+    for ( const auto& it : mDebugOutput->repeats )
+    {
+        if ( !it.second.pending )
+            continue;
+
+        double d = std::max(0.0, it.second.lastLogged + debug_repeat_interval - now);
+        if ( delay < 0 || d < delay )
+            delay = d;
+    }
+    return delay;
+}
+//-----------------------------------------------------------------------------
+bool vlGLFW::GLFW_window::renderDamaged( void )
+{
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    const RectI full(0, 0, width, height);
+
+    // what changed since the previous frame
+    RectI damage = mFullDamage ? full : rectIntersection(mPendingDamage, full);
+    if ( rectEmpty(damage) )
+    {
+        // e.g. dirty rects outside of the framebuffer, drop them so the window goes back to sleep
+        mPendingDamage = RectI(0, 0, 0, 0);
+        ++mDamageStats.skippedFrames;
+        return false;
+    }
+
+    // the back buffer also lacks what changed in the frames presented after it
+    RectI redraw = damage;
+    int age = backBufferAge();
+    if ( age <= 0 || size_t(age - 1) > mDamageHistory.size() )
+        redraw = full;
+    else
+    {
+        for ( int i = 0; i < age - 1; ++i )
+            redraw = rectUnion(redraw, mDamageHistory[i]);
+    }
+
+    mDamageRegion = redraw;
+    mDamageScissor->setScissor(redraw);
+    mSurfaceDamage = damage;
+    mPendingDamage = RectI(0, 0, 0, 0);
+    mFullDamage = false;
+
+    bool partial = rectArea(redraw) < rectArea(full);
+    if ( partial )
+    {
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(redraw.x(), redraw.y(), redraw.width(), redraw.height());
+    }
+    mScissorPending = partial;
+    mScissorHeld = false;
+
+    double start = glfwGetTime();
+    dispatchRunEvent();
+    mDamageStats.renderTime += glfwGetTime() - start;
+
+    // nothing was presented by the run event
+    if ( mScissorPending )
+    {
+        mScissorHeld = scissorHeld();
+        mScissorPending = false;
+    }
+
+    if ( partial )
+        glDisable(GL_SCISSOR_TEST);
+
+    mDamageHistory.push_front(damage);
+    if ( mDamageHistory.size() > max_damage_history )
+        mDamageHistory.pop_back();
+
+    // VL's Renderer applies the damage scissor to the actors holding it, without either a viewport
+    // that reset the scissor redrew the whole window
+    bool held = partial && (mScissorHeld || mDamageScissor->referenceCount() > 1);
+    ++mDamageStats.frames;
+    if ( held )
+        ++mDamageStats.partialFrames;
+    mDamageStats.pixelsDrawn += held ? rectArea(redraw) : rectArea(full);
+    mDamageStats.pixelsFull += rectArea(full);
+    return true;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::addDirtyRect( int x, int y, int width, int height )
+{
+    mPendingDamage = rectUnion(mPendingDamage, RectI(x, y, width, height));
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::logDamageStats() const
+{
+    const DamageStats& s = mDamageStats;
+    double touched = s.pixelsFull ? 100.0 * s.pixelsDrawn / s.pixelsFull : 100.0;
+    double frame_ms = s.frames ? 1000.0 * s.renderTime / s.frames : 0.0;
+
+    Log::print( Say("vlGLFW damage: %n frames (%n partial, %n skipped), %.1n percent of pixels touched, %.3nms per frame\n")
+                << s.frames << s.partialFrames << s.skippedFrames << touched << frame_ms );
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::initDamageExtensions( void )
+{
+    mSwapWithDamage = nullptr;
+    mBufferAgeSupported = false;
+
+#ifdef VLGLFW_USE_EGL
+    if ( glfwGetWindowAttrib(window, GLFW_CONTEXT_CREATION_API) != GLFW_EGL_CONTEXT_API )
+        return;
+
+    const char* ext = eglQueryString(glfwGetEGLDisplay(), EGL_EXTENSIONS);
+    if ( !ext )
+        return;
+
+    const std::string extensions = std::string(" ") + ext + " ";
+    auto has = [&extensions]( const char* name )
+    {
+        return extensions.find(std::string(" ") + name + " ") != std::string::npos;
+    };
+
+    if ( has("EGL_KHR_swap_buffers_with_damage") )
+        mSwapWithDamage = reinterpret_cast<GLFWglproc>(eglGetProcAddress("eglSwapBuffersWithDamageKHR"));
+    else if ( has("EGL_EXT_swap_buffers_with_damage") )
+        mSwapWithDamage = reinterpret_cast<GLFWglproc>(eglGetProcAddress("eglSwapBuffersWithDamageEXT"));
+
+    mBufferAgeSupported = has("EGL_EXT_buffer_age");
+#endif
+}
+//-----------------------------------------------------------------------------
+bool vlGLFW::GLFW_window::scissorHeld( void ) const
+{
+    if ( !glIsEnabled(GL_SCISSOR_TEST) )
+        return false;
+
+    GLint box[4];
+    glGetIntegerv(GL_SCISSOR_BOX, box);
+    return box[0] >= mDamageRegion.x() && box[1] >= mDamageRegion.y() &&
+           box[0] + box[2] <= mDamageRegion.x() + mDamageRegion.width() &&
+           box[1] + box[3] <= mDamageRegion.y() + mDamageRegion.height();
+}
+//-----------------------------------------------------------------------------
+int vlGLFW::GLFW_window::backBufferAge( void ) const
+{
+#ifdef VLGLFW_USE_EGL
+    EGLint age = 0;
+    if ( mBufferAgeSupported && eglQuerySurface(glfwGetEGLDisplay(), glfwGetEGLSurface(window), EGL_BUFFER_AGE_EXT, &age) )
+        return age;
+#endif
+    return 0;
+}
 
 // key callback
 void vlGLFW::GLFW_window::keyCallback( GLFWwindow* w, int key, int scancode, int action, int mods )
@@ -465,7 +1297,39 @@ void vlGLFW::GLFW_window::dropCallback( int fileCount, const char** paths )
     for ( int i = 0; i < fileCount; ++i )
         files.emplace_back(paths[i]);
 
-    dispatchFileDroppedEvent(files);
+    if ( mDropLoader )
+        mDropLoader->load(files);
+    else
+        dispatchFileDroppedEvent(files);
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::setAsyncDropLoading( bool enabled )
+{
+    if ( !enabled )
+    {
+        mDropLoader.reset();
+        return;
+    }
+
+    if ( !mDropLoader )
+    {
+        mDropLoader.reset(new DropLoader);
+        mDropLoader->setBatchCallback([this]( const std::vector< ref<DroppedFile> >& files ) { dispatchDroppedFiles(files); });
+    }
+}
+
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::dispatchDroppedFiles( const std::vector< ref<DroppedFile> >& files )
+{
+    std::vector<String> paths;
+    for ( const auto& file : files )
+        paths.push_back(file->path());
+
+    // the listeners take what they need from droppedFiles(), the rest is unmapped afterwards
+    mDroppedFiles = files;
+    makeCurrent();
+    dispatchFileDroppedEvent(paths);
+    mDroppedFiles.clear();
 }
 
 // close callback
@@ -497,8 +1361,11 @@ void vlGLFW::GLFW_window::resizeCallback( GLFWwindow* w, int width, int height )
 
 void vlGLFW::GLFW_window::resizeCallback( int width, int height )
 {
+    makeCurrent();
+
     //  resizeEvent(width, height);
     glViewport(0, 0, (GLsizei)width, (GLsizei)height);
+    invalidate();
 }
 
 //-----------------------------------------------------------------------------
@@ -515,11 +1382,29 @@ void vlGLFW::GLFW_window::quitApplication()
 //-----------------------------------------------------------------------------
 void vlGLFW::GLFW_window::setWindowTitle( const vl::String& title )
 {
+    mTitle = title;
     glfwSetWindowTitle(window, title.toStdString().c_str());
 }
 //-----------------------------------------------------------------------------
 void vlGLFW::GLFW_window::swapBuffers()
 {
+    // the applet may reset the scissor after presenting, look at it while the frame is complete
+    if ( mScissorPending )
+    {
+        mScissorHeld = scissorHeld();
+        mScissorPending = false;
+    }
+
+#ifdef VLGLFW_USE_EGL
+    if ( mPartialRedraw && mSwapWithDamage && !rectEmpty(mSurfaceDamage) )
+    {
+        EGLint rect[4] = { mSurfaceDamage.x(), mSurfaceDamage.y(), mSurfaceDamage.width(), mSurfaceDamage.height() };
+        auto swap = reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(mSwapWithDamage);
+
+        if ( swap(glfwGetEGLDisplay(), glfwGetEGLSurface(window), rect, 1) )
+            return;
+    }
+#endif
     glfwSwapBuffers(window);
 }
 //-----------------------------------------------------------------------------
@@ -527,6 +1412,70 @@ void vlGLFW::GLFW_window::setPosition( int x, int y )
 {
     glfwSetWindowPos(window, x, y);
 }
+//-----------------------------------------------------------------------------
+int vlGLFW::GLFW_window::refreshRate() const
+{
+    if ( !window )
+        return 0;
+
+    const MonitorTopology& topology = MonitorTopology::instance();
+    if ( GLFWmonitor* monitor = glfwGetWindowMonitor(window) )
+        return topology.refreshRate(monitor);
+
+    // windowed: the monitor under the center of the window
+    int x, y, w, h;
+    glfwGetWindowPos(window, &x, &y);
+    glfwGetWindowSize(window, &w, &h);
+    const MonitorTopology::Monitor* m = topology.monitorAt(x + w / 2, y + h / 2);
+    if ( !m )
+        m = topology.primary();
+    return m ? m->current.refreshRate : 0;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::GLFW_window::close()
+{
+    if ( window )
+        glfwSetWindowShouldClose(window, GL_TRUE);
+}
+
+// iconify callback
+void vlGLFW::GLFW_window::iconifyCallback( GLFWwindow* w, int iconified )
+{
+    lock();
+    GLFW_window* gw = winFind(w);
+
+    if ( gw )
+        gw->iconifyCallback(iconified);
+    unlock();
+}
+
+void vlGLFW::GLFW_window::iconifyCallback( int iconified )
+{
+    mIconified = iconified != 0;
+    updateWindowState();
+    dispatchVisibilityEvent(!mIconified && !mHidden);
+
+    // the back buffer content is not preserved while iconified
+    if ( !mIconified )
+        invalidate();
+}
+
+// focus callback
+void vlGLFW::GLFW_window::focusCallback( GLFWwindow* w, int focused )
+{
+    lock();
+    GLFW_window* gw = winFind(w);
+
+    if ( gw )
+        gw->focusCallback(focused);
+    unlock();
+}
+
+void vlGLFW::GLFW_window::focusCallback( int focused )
+{
+    mFocused = focused != 0;
+    updateWindowState();
+}
 
 // find the GLFW_window object whose window is w
 vlGLFW::GLFW_window* vlGLFW::GLFW_window::winFind( GLFWwindow const* w )
@@ -545,6 +1494,7 @@ vlGLFW::GLFW_window* vlGLFW::GLFW_window::winFind( GLFWwindow const* w )
 }
 
 std::unique_ptr<std::mutex> vlGLFW::GLFW_window::mtx;
+vlGLFW::GLFW_window::LoopStats vlGLFW::GLFW_window::eventLoopStats;
 std::list<vlGLFW::GLFW_window*> vlGLFW::GLFW_window::GLFW_windowList;
 
 //-----------------------------------------------------------------------------
@@ -33,12 +33,19 @@
 #define GLFWAdapter_INCLUDE_ONCE
 
 #include <vlGLFW/link_config.hpp>
+#include <vlGLFW/DropLoader.hpp>
+#include <vlGLFW/MonitorTopology.hpp>
 #include <vlGraphics/OpenGLContext.hpp>
+#include <vlGraphics/Scissor.hpp>
 #include <vlCore/String.hpp>
 #include <vlCore/Vector4.hpp>
+#include <vlCore/Rect.hpp>
 #include <GLFW/GLFW3.h>
 #include <mutex>
 #include <list>
+#include <deque>
+#include <memory>
+#include <vector>
 
 namespace vlut
 {
@@ -66,6 +73,26 @@ public:
 
 	void setPosition(int x, int y);
 
+	/**
+	 * If set before initGLFW_window(), a fullscreen window takes the size, color depth and refresh rate of the
+	 * monitor's current mode so that no mode switch happens. Otherwise the monitor mode closest to the requested size
+	 * is used, at its highest refresh rate.
+	*/
+	void setBorderlessFullscreen(bool borderless) { mBorderlessFullscreen = borderless; }
+
+	bool borderlessFullscreen() const { return mBorderlessFullscreen; }
+
+	//! Refresh rate in Hz of the monitor showing the window, 0 if unknown
+	int refreshRate() const;
+
+	//! Asks the event loop to destroy this window on its next iteration
+	void close();
+
+	//! If set before initGLFW_window() the window is created but never shown, useful for benchmarks under Xvfb
+	void setStartHidden(bool hidden) { mStartHidden = hidden; }
+
+	bool startHidden() const { return mStartHidden; }
+
 	virtual void swapBuffers();
 
 	//! Quits the event loop
@@ -88,10 +115,12 @@ public:
 	{
 	}
 
-	void makeCurrent()
-	{
-		glfwMakeContextCurrent(window);
-	}
+	//! Makes the context current, skipping the switch if it already is. Main thread only, like the event loop:
+	//! the switch counters of loopStats() are not synchronized.
+	void makeCurrent();
+
+	//! Call after making a context current with glfwMakeContextCurrent() directly, so makeCurrent() does not skip a needed switch
+	static void syncCurrentContext();
 
 	static void setThreadSafe(void)
 	{
@@ -100,6 +129,193 @@ public:
 
 	static void eventLoop(void);
 
+	//! Counters of the event loop, shared by all windows
+	struct LoopStats
+	{
+		unsigned long long iterations = 0; //!< passes over the window list
+		unsigned long long frames = 0;     //!< frames rendered by all windows
+		double time = 0;                   //!< seconds spent in eventLoop()
+		double frameTime = 0;              //!< seconds spent rendering frames, the rest is event loop overhead
+		unsigned long long contextSwitches = 0;   //!< glfwMakeContextCurrent() calls made by makeCurrent()
+		unsigned long long redundantSwitches = 0; //!< makeCurrent() calls skipped because the context was already current
+	};
+
+	//! Updated by the main thread, read it from there
+	static const LoopStats& loopStats() { return eventLoopStats; }
+
+	//! Records the duration in seconds of every frame rendered by this window
+	void setRecordFrameTimes(bool record) { mRecordFrameTimes = record; }
+
+	const std::vector<float>& frameTimes() const { return mFrameTimes; }
+
+	//! The context actually obtained when the performance profile is enabled
+	struct ContextProfile
+	{
+		int major = 0;
+		int minor = 0;
+		bool core = false;
+		bool noError = false;
+		int depthBits = 0;
+		int stencilBits = 0;
+		int samples = 0;
+	};
+
+	/**
+	 * Requests a lean context from the next initGLFW_window(): an OpenGL core profile of the given version created
+	 * with GLFW_CONTEXT_NO_ERROR, without accumulation or stereo buffers. Depth, stencil, color and multisample
+	 * settings still come from the OpenGLContextFormat. With KHR_no_error any invalid call is undefined behavior,
+	 * so enable this only for applets already verified with a regular or debug context.
+	*/
+	void setPerformanceProfile(bool enabled, int major = 3, int minor = 3)
+	{
+		mPerformanceProfile = enabled;
+		mProfileMajor = major;
+		mProfileMinor = minor;
+	}
+
+	bool performanceProfile() const { return mPerformanceProfile; }
+
+	//! What the driver granted for the performance profile, filled by initGLFW_window()
+	const ContextProfile& contextProfile() const { return mContextProfile; }
+
+	/**
+	 * Loads dropped files on background threads instead of dispatching the file dropped event right away. By default
+	 * the event is dispatched at a frame boundary once every file of the drop is mapped and paged in, and its
+	 * listeners read the mapped files, and the payloads of the parser installed on dropLoader(), from
+	 * droppedFiles() instead of opening the paths again. Install a ready callback on dropLoader() to receive each
+	 * file as soon as it is done instead. Pending loads are cancelled when the window closes.
+	*/
+	void setAsyncDropLoading(bool enabled);
+
+	//! The loader used for dropped files, null unless setAsyncDropLoading() is enabled
+	DropLoader* dropLoader() { return mDropLoader.get(); }
+
+	//! The loaded files of the drop being dispatched, valid during the file dropped event: keep a ref to the
+	//! ones still needed afterwards, the others are unmapped when the event returns
+	const std::vector< vl::ref<DroppedFile> >& droppedFiles() const { return mDroppedFiles; }
+
+	//! What the event loop does with a window that is not the active one
+	enum EInactivePolicy
+	{
+		IP_FullRate,        //!< always render
+		IP_PauseIconified,  //!< stop rendering while iconified or hidden
+		IP_ReduceUnfocused  //!< stop rendering while iconified or hidden, render at unfocusedFrameRate() while unfocused
+	};
+
+	enum EWindowState
+	{
+		WS_Active,
+		WS_Unfocused,
+		WS_Iconified,  //!< iconified or hidden, e.g. with glfwHideWindow() or setStartHidden()
+		WS_Count
+	};
+
+	void setInactivePolicy(EInactivePolicy policy) { mInactivePolicy = policy; }
+
+	EInactivePolicy inactivePolicy() const { return mInactivePolicy; }
+
+	//! Frames per second rendered by an unfocused window with the IP_ReduceUnfocused policy
+	void setUnfocusedFrameRate(double fps) { mUnfocusedFrameRate = fps; }
+
+	double unfocusedFrameRate() const { return mUnfocusedFrameRate; }
+
+	EWindowState windowState() const { return mWindowState; }
+
+	//! Seconds spent in the given state since the window was created
+	double timeInState(EWindowState state) const;
+
+	//! Frames rendered while in the given state
+	unsigned long long framesInState(EWindowState state) const { return mStateFrames[state]; }
+
+	//! Prints the time and frames spent in each state to vl::Log
+	void logStateTimes() const;
+
+	//! Counters of the OpenGL debug messages received by this window
+	struct DebugStats
+	{
+		unsigned int performanceLastFrame = 0;  //!< GL_DEBUG_TYPE_PERFORMANCE messages received during the last rendered frame
+		unsigned long long performance = 0;     //!< GL_DEBUG_TYPE_PERFORMANCE messages received since creation
+		unsigned long long messages = 0;        //!< messages of any type received since creation
+		unsigned long long suppressed = 0;      //!< repeated messages not forwarded to vl::Log
+		unsigned long long dropped = 0;         //!< messages lost because the ring was full
+	};
+
+	/**
+	 * Requests a debug context from the next initGLFW_window() and installs a KHR_debug callback on it. Messages
+	 * are queued in a lock-free ring, since drivers may call back from their own threads, and forwarded to vl::Log
+	 * by the event loop whether or not the window renders: repeats of the same message are counted instead of
+	 * logged more than once per second, the count being reported once the second is over, and a summary of the
+	 * driver's performance messages is printed at most once per second. Takes precedence over the
+	 * no-error request of setPerformanceProfile().
+	*/
+	void setDebugContext(bool enabled);
+
+	bool debugContext() const { return mDebugContext; }
+
+	/**
+	 * Enables or disables the debug messages matching source, type and severity, any of which can be GL_DONT_CARE.
+	 * Filters are applied in order after the defaults, which drop GL_DEBUG_SEVERITY_NOTIFICATION messages. Filters
+	 * added after initGLFW_window() take effect immediately and require the window's context to be current.
+	*/
+	void addDebugFilter(GLenum source, GLenum type, GLenum severity, bool enabled);
+
+	const DebugStats& debugStats() const;
+
+	//! Statistics collected while partial redraw is enabled
+	struct DamageStats
+	{
+		unsigned long long frames = 0;        //!< frames rendered
+		unsigned long long partialFrames = 0; //!< frames whose rendering stayed inside a scissor smaller than the window
+		unsigned long long skippedFrames = 0; //!< frames skipped because the dirty region was outside of the framebuffer
+		unsigned long long pixelsDrawn = 0;   //!< pixels inside the scissor, or the whole window if it was lost, summed over all frames
+		unsigned long long pixelsFull = 0;    //!< pixels a full redraw would have touched, summed over all frames
+		double renderTime = 0;                //!< seconds spent in dispatchRunEvent()
+	};
+
+	/**
+	 * Enables damage tracking: the window is redrawn only when a region has been marked dirty, rendering is
+	 * scissored to the union of the dirty regions and, when the context runs on EGL (build with VLGLFW_USE_EGL),
+	 * the frame is presented with EGL_KHR_swap_buffers_with_damage using EGL_EXT_buffer_age to know which part
+	 * of the back buffer is still valid. Without those extensions every redraw covers the whole window.
+	 *
+	 * vl::Viewport and vl::Renderer reset the scissor set by the binding, so VL applets limit their rendering with
+	 * damageScissor(): attach it to every actor drawn in the window with vl::Actor::setScissor(), and since the
+	 * viewport clears all of it, set its clear flags to vl::CF_DO_NOT_CLEAR and clear from updateScene(), which
+	 * still runs under the binding's scissor. A frame is reported as partial in damageStats() if the damage
+	 * scissor is attached or the scissor set by the binding still holds when the frame is presented, otherwise
+	 * as a full redraw. GLFW_benchmark's --partial-redraw option shows the setup.
+	*/
+	void setPartialRedrawEnabled(bool enabled)
+	{
+		mPartialRedraw = enabled;
+		invalidate();
+	}
+
+	bool partialRedrawEnabled() const { return mPartialRedraw; }
+
+	//! Marks a framebuffer region (OpenGL convention, origin at the bottom-left corner) as needing a redraw
+	void addDirtyRect(int x, int y, int width, int height);
+
+	//! Marks the whole framebuffer as needing a redraw
+	void invalidate()
+	{
+		mFullDamage = true;
+	}
+
+	//! The region being redrawn in the current frame, valid while dispatchRunEvent() is running.
+	//! Applets whose viewport sets its own scissor should clip it to this region.
+	const vl::RectI& damageRegion() const { return mDamageRegion; }
+
+	//! A scissor kept equal to damageRegion(), for the actors rendered in this window
+	vl::Scissor* damageScissor() { return mDamageScissor.get(); }
+
+	const DamageStats& damageStats() const { return mDamageStats; }
+
+	void resetDamageStats() { mDamageStats = DamageStats(); }
+
+	//! Prints the damage statistics to vl::Log
+	void logDamageStats() const;
+
 protected:
 	// key callback
 	static void keyCallback(GLFWwindow *w, int key, int scancode, int action, int mods);
@@ -121,6 +337,9 @@ protected:
 	static void dropCallback(GLFWwindow *w, int fileCount, const char **paths);
 	void dropCallback(int fileCount, const char **paths);
 
+	// dispatches the file dropped event for a batch loaded by the DropLoader
+	void dispatchDroppedFiles(const std::vector< vl::ref<DroppedFile> >& files);
+
 	// close callback
 	static void closeCallback(GLFWwindow *w);
 	void closeCallback(void);
@@ -129,9 +348,56 @@ protected:
 	static void resizeCallback(GLFWwindow *w, int width, int height);
 	void resizeCallback(int width, int height);
 
+	// iconify callback
+	static void iconifyCallback(GLFWwindow *w, int iconified);
+	void iconifyCallback(int iconified);
+
+	// focus callback
+	static void focusCallback(GLFWwindow *w, int focused);
+	void focusCallback(int focused);
+
+	// destroys the native window and forgets it if its context was current
+	void destroyWindow(void);
+
 	// find the GLFW_window object whose window is w
 	static GLFW_window* winFind(GLFWwindow const *w);
 
+	// reads back the context and pixel format granted for the performance profile
+	void verifyPerformanceProfile(const vl::OpenGLContextFormat& info);
+
+	// recomputes mWindowState from the iconified and focused flags
+	void updateWindowState(void);
+
+	// reads GLFW_VISIBLE, GLFW has no callback for windows shown or hidden by the application
+	void updateVisibility(void);
+
+	// seconds until this window wants its next frame according to its inactive policy and damage, negative if never
+	double nextFrameDelay(double now) const;
+
+	// runs one frame and forwards the debug messages it produced, false if there was nothing to redraw
+	bool renderFrame(void);
+
+	// runs one frame honoring the damage region, false if the region was empty
+	bool renderDamaged(void);
+
+	// installs the KHR_debug callback and the message filters
+	void initDebugOutput(void);
+
+	// forwards the queued debug messages and the due repeat counts to vl::Log
+	void flushDebugOutput(void);
+
+	// seconds until a suppressed debug message repeat or the performance summary is due, negative if none is pending
+	double debugFlushDelay(double now) const;
+
+	// queries EGL_KHR_swap_buffers_with_damage and EGL_EXT_buffer_age support for this window
+	void initDamageExtensions(void);
+
+	// returns how many frames old the back buffer content is, 0 if unknown
+	int backBufferAge(void) const;
+
+	// whether the scissor set by renderDamaged() is still in effect
+	bool scissorHeld(void) const;
+
 	static void lock(void)
 	{
 		if (mtx)
@@ -145,8 +411,54 @@ protected:
 	}
 
 protected:
-    GLFWwindow* window;
-	double mx, my;
+    GLFWwindow* window = nullptr;
+	double mx = 0, my = 0;
+
+	std::unique_ptr<DropLoader> mDropLoader;
+	std::vector< vl::ref<DroppedFile> > mDroppedFiles;
+	bool mStartHidden = false;
+	bool mBorderlessFullscreen = false;
+	bool mRecordFrameTimes = false;
+	std::vector<float> mFrameTimes;
+	static LoopStats eventLoopStats;
+
+	// inactive windows
+	EInactivePolicy mInactivePolicy = IP_FullRate;
+	double mUnfocusedFrameRate = 10;
+	bool mIconified = false;
+	bool mHidden = false;
+	bool mFocused = true;
+	EWindowState mWindowState = WS_Active;
+	double mStateSince = 0;
+	double mLastFrame = 0;
+	double mStateTime[WS_Count] = {};
+	unsigned long long mStateFrames[WS_Count] = {};
+
+	// context profile
+	bool mPerformanceProfile = false;
+	int mProfileMajor = 3;
+	int mProfileMinor = 3;
+	ContextProfile mContextProfile;
+
+	// debug output
+	struct DebugOutput;
+	bool mDebugContext = false;
+	std::unique_ptr<DebugOutput> mDebugOutput;
+	vl::String mTitle;
+
+	// damage tracking
+	bool mPartialRedraw = false;
+	bool mFullDamage = true;
+	bool mBufferAgeSupported = false;
+	GLFWglproc mSwapWithDamage = nullptr;
+	vl::RectI mPendingDamage = vl::RectI(0, 0, 0, 0);
+	vl::RectI mDamageRegion;
+	vl::RectI mSurfaceDamage;
+	bool mScissorPending = false;
+	bool mScissorHeld = false;
+	vl::ref<vl::Scissor> mDamageScissor = new vl::Scissor;
+	std::deque<vl::RectI> mDamageHistory;
+	DamageStats mDamageStats;
 	static std::list<GLFW_window *> GLFW_windowList;
 	static std::unique_ptr<std::mutex> mtx;
 };
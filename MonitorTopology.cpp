@@ -0,0 +1,185 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2016, Michele Bosi, John Lagerquist                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "vlGLFW/MonitorTopology.hpp"
+#include <cstdlib>
+
+using namespace vlGLFW;
+
+namespace
+{
+MonitorTopology::VideoMode toVideoMode( const GLFWvidmode& m )
+{
+    MonitorTopology::VideoMode mode;
+    mode.width = m.width;
+    mode.height = m.height;
+    mode.redBits = m.redBits;
+    mode.greenBits = m.greenBits;
+    mode.blueBits = m.blueBits;
+    mode.refreshRate = m.refreshRate;
+    return mode;
+}
+}
+
+//-----------------------------------------------------------------------------
+MonitorTopology& vlGLFW::MonitorTopology::instance()
+{
+    static MonitorTopology topology;
+    return topology;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::MonitorTopology::install()
+{
+    if ( mInstalled )
+        return;
+
+    glfwSetMonitorCallback(monitorCallback);
+    mInstalled = true;
+    refresh();
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::MonitorTopology::uninstall()
+{
+    mInstalled = false;
+    if ( !mStubbed )
+        assign(std::vector<Monitor>());
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::MonitorTopology::clear()
+{
+    mStubbed = false;
+    assign(std::vector<Monitor>());
+
+    if ( mInstalled )
+        refresh();
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::MonitorTopology::refresh()
+{
+    if ( mStubbed )
+        return;
+
+    std::vector<Monitor> monitors;
+    int count = 0;
+    GLFWmonitor** handles = glfwGetMonitors(&count);
+
+    for ( int i = 0; i < count; ++i )
+    {
+        Monitor m;
+        m.handle = handles[i];
+        if ( const char* name = glfwGetMonitorName(handles[i]) )
+            m.name = name;
+        glfwGetMonitorPos(handles[i], &m.x, &m.y);
+
+        if ( const GLFWvidmode* current = glfwGetVideoMode(handles[i]) )
+            m.current = toVideoMode(*current);
+
+        int mode_count = 0;
+        const GLFWvidmode* modes = glfwGetVideoModes(handles[i], &mode_count);
+        for ( int j = 0; j < mode_count; ++j )
+            m.modes.push_back(toVideoMode(modes[j]));
+
+        monitors.push_back(m);
+    }
+
+    assign(monitors);
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::MonitorTopology::setMonitors( const std::vector<Monitor>& monitors )
+{
+    mStubbed = true;
+    assign(monitors);
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::MonitorTopology::assign( const std::vector<Monitor>& monitors )
+{
+    mMonitors = monitors;
+    ++mGeneration;
+}
+//-----------------------------------------------------------------------------
+const MonitorTopology::Monitor* vlGLFW::MonitorTopology::find( GLFWmonitor* handle ) const
+{
+    for ( const Monitor& m : mMonitors )
+    {
+        if ( m.handle == handle )
+            return &m;
+    }
+    return nullptr;
+}
+//-----------------------------------------------------------------------------
+const MonitorTopology::Monitor* vlGLFW::MonitorTopology::monitorAt( int x, int y ) const
+{
+    for ( const Monitor& m : mMonitors )
+    {
+        if ( x >= m.x && y >= m.y && x < m.x + m.current.width && y < m.y + m.current.height )
+            return &m;
+    }
+    return nullptr;
+}
+//-----------------------------------------------------------------------------
+int vlGLFW::MonitorTopology::refreshRate( GLFWmonitor* handle ) const
+{
+    const Monitor* m = find(handle);
+    return m ? m->current.refreshRate : 0;
+}
+//-----------------------------------------------------------------------------
+const MonitorTopology::VideoMode* vlGLFW::MonitorTopology::bestMode( const Monitor& monitor, int width, int height )
+{
+    const VideoMode* best = nullptr;
+    int best_distance = 0;
+
+    for ( const VideoMode& mode : monitor.modes )
+    {
+        int distance = std::abs(mode.width - width) + std::abs(mode.height - height);
+
+        if ( !best || distance < best_distance )
+        {
+            best = &mode;
+            best_distance = distance;
+            continue;
+        }
+
+        if ( distance > best_distance )
+            continue;
+
+        int bits = mode.redBits + mode.greenBits + mode.blueBits;
+        int best_bits = best->redBits + best->greenBits + best->blueBits;
+        if ( mode.refreshRate > best->refreshRate || (mode.refreshRate == best->refreshRate && bits > best_bits) )
+            best = &mode;
+    }
+    return best;
+}
+//-----------------------------------------------------------------------------
+void vlGLFW::MonitorTopology::monitorCallback( GLFWmonitor*, int )
+{
+    instance().refresh();
+}
+//-----------------------------------------------------------------------------
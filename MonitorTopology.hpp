@@ -0,0 +1,127 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2016, Michele Bosi, John Lagerquist                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef MonitorTopology_INCLUDE_ONCE
+#define MonitorTopology_INCLUDE_ONCE
+
+#include <vlGLFW/link_config.hpp>
+#include <vlCore/String.hpp>
+#include <GLFW/GLFW3.h>
+#include <vector>
+
+namespace vlGLFW
+{
+//-----------------------------------------------------------------------------
+// MonitorTopology
+//-----------------------------------------------------------------------------
+/**
+ * Cache of the connected monitors and their video modes, refreshed by the GLFW monitor callback so that creating
+ * a fullscreen window or pacing frames does not query the window system every time. The list can also be replaced
+ * with setMonitors(), e.g. by a stubbed one when testing mode selection; a stubbed list is kept across refreshes,
+ * monitor events and GLFW terminations until clear() is called.
+*/
+class VLGLFW_EXPORT MonitorTopology
+{
+public:
+	struct VideoMode
+	{
+		int width = 0;
+		int height = 0;
+		int redBits = 0;
+		int greenBits = 0;
+		int blueBits = 0;
+		int refreshRate = 0;
+	};
+
+	struct Monitor
+	{
+		GLFWmonitor* handle = nullptr;
+		vl::String name;
+		int x = 0;
+		int y = 0;
+		VideoMode current;
+		std::vector<VideoMode> modes;
+	};
+
+	static MonitorTopology& instance();
+
+	//! Installs the GLFW monitor callback and fills the cache, GLFW must be initialized
+	void install();
+
+	//! Called when GLFW terminates, forgets the monitors unless they were stubbed
+	void uninstall();
+
+	//! Forgets every monitor and any stub, the list is queried again if the callback is installed
+	void clear();
+
+	//! Queries GLFW for the connected monitors and their video modes, does nothing while the list is stubbed
+	void refresh();
+
+	//! Replaces the cached list with a stub kept until clear(), the first monitor is the primary one
+	void setMonitors(const std::vector<Monitor>& monitors);
+
+	bool stubbed() const { return mStubbed; }
+
+	const std::vector<Monitor>& monitors() const { return mMonitors; }
+
+	//! Incremented every time the list changes
+	unsigned generation() const { return mGeneration; }
+
+	const Monitor* primary() const { return mMonitors.empty() ? nullptr : &mMonitors.front(); }
+
+	const Monitor* find(GLFWmonitor* handle) const;
+
+	//! The monitor whose current mode covers the given point of the virtual desktop, null if none does
+	const Monitor* monitorAt(int x, int y) const;
+
+	//! Refresh rate in Hz of the monitor's current mode, 0 if unknown
+	int refreshRate(GLFWmonitor* handle) const;
+
+	/**
+	 * The mode closest in size to width x height, preferring the highest refresh rate and then the deepest color
+	 * among modes of equal size. Returns null if the monitor reports no modes.
+	*/
+	static const VideoMode* bestMode(const Monitor& monitor, int width, int height);
+
+protected:
+	static void monitorCallback(GLFWmonitor* monitor, int event);
+
+	void assign(const std::vector<Monitor>& monitors);
+
+protected:
+	std::vector<Monitor> mMonitors;
+	unsigned mGeneration = 0;
+	bool mInstalled = false;
+	bool mStubbed = false;
+};
+}
+
+#endif
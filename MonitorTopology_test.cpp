@@ -0,0 +1,117 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2016, Michele Bosi, John Lagerquist                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+// Checks MonitorTopology's mode selection and lookups against a stubbed monitor list, no display needed.
+// Returns 0 when every check passes.
+//
+// usage: MonitorTopology_test
+
+#include <vlGLFW/MonitorTopology.hpp>
+#include <cstdio>
+#include <vector>
+
+using namespace vlGLFW;
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what)
+  {
+    if (!ok)
+    {
+      std::printf("FAILED: %s\n", what);
+      ++failures;
+    }
+  }
+
+  MonitorTopology::VideoMode mode(int width, int height, int bits, int refresh_rate)
+  {
+    MonitorTopology::VideoMode m;
+    m.width = width;
+    m.height = height;
+    m.redBits = m.greenBits = m.blueBits = bits;
+    m.refreshRate = refresh_rate;
+    return m;
+  }
+}
+
+int main(int, char*[])
+{
+  // handles are only compared, never passed to GLFW
+  GLFWmonitor* left = reinterpret_cast<GLFWmonitor*>(0x10);
+  GLFWmonitor* right = reinterpret_cast<GLFWmonitor*>(0x20);
+
+  std::vector<MonitorTopology::Monitor> monitors(2);
+  monitors[0].handle = left;
+  monitors[0].name = "left";
+  monitors[0].current = mode(1920, 1080, 8, 60);
+  monitors[0].modes.push_back(mode(1280, 720, 8, 60));
+  monitors[0].modes.push_back(mode(1920, 1080, 6, 144));
+  monitors[0].modes.push_back(mode(1920, 1080, 8, 60));
+  monitors[0].modes.push_back(mode(1920, 1080, 8, 144));
+  monitors[1].handle = right;
+  monitors[1].name = "right";
+  monitors[1].x = 1920;
+  monitors[1].current = mode(2560, 1440, 8, 75);
+  monitors[1].modes.push_back(monitors[1].current);
+
+  MonitorTopology& topology = MonitorTopology::instance();
+  topology.setMonitors(monitors);
+  unsigned generation = topology.generation();
+
+  // bestMode(): closest size, then highest refresh rate, then deepest color
+  const MonitorTopology::VideoMode* best = MonitorTopology::bestMode(*topology.find(left), 1900, 1000);
+  check(best && best->width == 1920 && best->refreshRate == 144 && best->redBits == 8, "bestMode picks 1920x1080 8 bit at 144 Hz");
+  best = MonitorTopology::bestMode(*topology.find(left), 1024, 600);
+  check(best && best->width == 1280 && best->height == 720, "bestMode picks the closest size");
+  check(MonitorTopology::bestMode(MonitorTopology::Monitor(), 800, 600) == nullptr, "bestMode without modes returns null");
+
+  // find() and the lookups built on it
+  check(topology.find(right) && topology.find(right)->name == "right", "find returns the stubbed monitor");
+  check(topology.find(reinterpret_cast<GLFWmonitor*>(0x30)) == nullptr, "find returns null for an unknown handle");
+  check(topology.primary() == topology.find(left), "the first monitor is the primary one");
+  check(topology.refreshRate(right) == 75, "refreshRate reports the current mode");
+  check(topology.monitorAt(2000, 100) == topology.find(right), "monitorAt finds the monitor covering the point");
+
+  // the stub survives refreshes and GLFW terminations, only clear() drops it
+  topology.refresh();
+  topology.uninstall();
+  check(topology.stubbed() && topology.monitors().size() == 2 && topology.generation() == generation, "the stub is kept");
+  topology.clear();
+  check(!topology.stubbed() && topology.monitors().empty(), "clear drops the stub");
+
+  if (failures)
+    return 1;
+
+  std::printf("MonitorTopology: all checks passed\n");
+  return 0;
+}
@@ -45,4 +45,8 @@
   #define VLGLFW_EXPORT
 #endif
 
+// VLGLFW_USE_EGL: define it (and link EGL) to create the contexts through EGL, GLFW must be built with EGL
+// support. Partial redraws then present with EGL_KHR_swap_buffers_with_damage and reuse the back buffer
+// according to EGL_EXT_buffer_age, otherwise every redraw covers and presents the whole window.
+
 #endif // VLGLFW_CONFIG_INCLUDE_ONCE